@@ -13,9 +13,18 @@ QMAKE_CXXFLAGS_RELEASE += -Oi -Ot -Qpar -fp:precise
 
 SOURCES += \
     include/regression_ga/src/fitness/converter.cpp \
+    include/regression_ga/src/fitness/coreset.cpp \
+    include/regression_ga/src/fitness/dataset.cpp \
     include/regression_ga/src/fitness/decoder.cpp \
+    include/regression_ga/src/fitness/domain_analysis.cpp \
     include/regression_ga/src/fitness/fitness_function.cpp \
+    include/regression_ga/src/fitness/least_squares.cpp \
+    include/regression_ga/src/fitness/differentiator.cpp \
     include/regression_ga/src/fitness/math_ops.cpp \
+    include/regression_ga/src/fitness/simplifier.cpp \
+    include/regression_ga/src/fitness/term_cache.cpp \
+    include/regression_ga/src/fitness/term_records.cpp \
+    include/regression_ga/src/fitness/vector_math.cpp \
     include/regression_ga/src/genetic/crossover.cpp \
     include/regression_ga/src/genetic/ga.cpp \
     include/regression_ga/src/genetic/generate.cpp \
@@ -29,6 +38,7 @@ HEADERS += \
     genetic_regression.h \
     include/regression_ga/include/genetic_algorithm/base_ga.h \
     include/regression_ga/include/genetic_algorithm/binary_ga.h \
+    include/regression_ga/include/genetic_algorithm/fitness_cache.h \
     include/regression_ga/include/genetic_algorithm/genetic_algorithm.h \
     include/regression_ga/include/genetic_algorithm/integer_ga.h \
     include/regression_ga/include/genetic_algorithm/mo_detail.h \
@@ -36,11 +46,22 @@ HEADERS += \
     include/regression_ga/include/genetic_algorithm/real_ga.h \
     include/regression_ga/include/genetic_algorithm/reference_points.h \
     include/regression_ga/include/genetic_algorithm/rng.h \
+    include/regression_ga/include/genetic_algorithm/thread_pool.h \
     include/regression_ga/src/fitness/converter.h \
+    include/regression_ga/src/fitness/coreset.h \
+    include/regression_ga/src/fitness/dataset.h \
     include/regression_ga/src/fitness/decoder.h \
+    include/regression_ga/src/fitness/domain_analysis.h \
     include/regression_ga/src/fitness/fitness_function.h \
+    include/regression_ga/src/fitness/least_squares.h \
+    include/regression_ga/src/fitness/differentiator.h \
     include/regression_ga/src/fitness/math_ops.h \
+    include/regression_ga/src/fitness/program.h \
+    include/regression_ga/src/fitness/simplifier.h \
+    include/regression_ga/src/fitness/term_cache.h \
+    include/regression_ga/src/fitness/term_records.h \
     include/regression_ga/src/fitness/token.h \
+    include/regression_ga/src/fitness/vector_math.h \
     include/regression_ga/src/genetic/crossover.h \
     include/regression_ga/src/genetic/ga.h \
     include/regression_ga/src/genetic/gene.h \
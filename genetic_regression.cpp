@@ -11,8 +11,13 @@
 
 #include "include/regression_ga/src/genetic/ga.h"
 #include "include/regression_ga/src/fitness/fitness_function.h"
+#include "include/regression_ga/src/fitness/dataset.h"
+#include "include/regression_ga/src/fitness/coreset.h"
+#include "include/regression_ga/src/fitness/domain_analysis.h"
 #include "include/regression_ga/src/fitness/converter.h"
+#include "include/regression_ga/src/fitness/simplifier.h"
 #include "include/regression_ga/src/fitness/token.h"
+#include "include/regression_ga/src/fitness/program.h"
 #include "include/regression_ga/src/printer.h"
 #include "include/regression_ga/src/io_utils.h"
 
@@ -20,6 +25,8 @@
 #include <vector>
 #include <string>
 #include <utility>
+#include <memory>
+#include <thread>
 #include <numeric>
 #include <exception>
 #include <stdexcept>
@@ -27,11 +34,11 @@
 #include <cstddef>
 
 
-QVector<QPointF> GeneticRegression::statsToPoints(const std::vector<double>& stats)
+QVector<QPointF> GeneticRegression::statsToPoints(const std::vector<double>& stats, size_t first)
 {
     QVector<QPointF> points;
-    points.reserve(stats.size());
-    for (size_t i = 0; i < stats.size(); i++)
+    points.reserve(stats.size() - first);
+    for (size_t i = first; i < stats.size(); i++)
     {
         points.emplace_back(double(i + 1), stats[i]);
     }
@@ -144,15 +151,14 @@ void GeneticRegression::on_pushButtonRUN_clicked()
 {
     /* Setup fitness function. */
 
-    std::vector<double> x, fx_desired;
+    std::shared_ptr<const Dataset> data;
 
     /* Fit function based on all of the data points. */
     if (!ui->panelRange->isChecked())
     {
-        x = x_data;
-        fx_desired = fx_data;
+        data = data_set;
 
-        if (x.size() < 2)
+        if (data->size() < 2)
         {
             QMessageBox::critical(this, "Error", "There are not enough data points to fit a function (need at least 2).");
             return;
@@ -161,12 +167,13 @@ void GeneticRegression::on_pushButtonRUN_clicked()
     /* Only use the data points in the specified range for fitting the function. */
     else
     {
-        for (size_t i = 0; i < x_data.size(); i++)
+        std::vector<double> x, fx_desired;
+        for (size_t i = 0; i < data_set->size(); i++)
         {
-            if (ui->inputRangeMin->value() <= x_data[i] && x_data[i] <= ui->inputRangeMax->value())
+            if (ui->inputRangeMin->value() <= data_set->x()[i] && data_set->x()[i] <= ui->inputRangeMax->value())
             {
-                x.push_back(x_data[i]);
-                fx_desired.push_back(fx_data[i]);
+                x.push_back(data_set->x()[i]);
+                fx_desired.push_back(data_set->fx_desired()[i]);
             }
         }
         if (x.size() < 2)
@@ -174,8 +181,25 @@ void GeneticRegression::on_pushButtonRUN_clicked()
             QMessageBox::critical(this, "Error", "There are not enough data points in the specified x interval to fit a function (need at least 2).");
             return;
         }
+        data = std::make_shared<const Dataset>(std::move(x), std::move(fx_desired));
     }
-    FitnessFunction fitness_function(x, fx_desired, static_cast<FitnessFunction::Objective>(ui->comboBoxObjective->currentIndex()));
+
+    /* Merge the adjacent points with close fx values into weighted points (the tolerance is relative to the range of the fx values). */
+    if (ui->checkBoxCoreset->isChecked())
+    {
+        auto [fx_min, fx_max] = std::minmax_element(data->fx_desired(), data->fx_desired() + data->size());
+        data = Coreset::build(*data, ui->inputCoresetTol->value() / 100.0 * (*fx_max - *fx_min));
+    }
+    FitnessFunction fitness_function(data, static_cast<FitnessFunction::Objective>(ui->comboBoxObjective->currentIndex()));
+
+    /* Evaluate the transcendental functions with the vectorized approximations instead of the standard library. */
+    if (ui->checkBoxFastMath->isChecked()) fitness_function.precision(Decoder::Precision::fast);
+
+    /*
+    * The points of the mapped data files are streamed from the file block by block, they don't have to fit in memory (the coresets are in memory).
+    * The features that evaluate the candidates one by one, or store values for every data point, are not used with them.
+    */
+    const bool streamed = data->mapped();
 
     /* Setup GA. */
     size_t chrom_len = size_t(ui->inputNumFuncs->value());
@@ -192,7 +216,29 @@ void GeneticRegression::on_pushButtonRUN_clicked()
     bounds.push_back({ ui->inputCoeffNmin->value(),
                        ui->inputCoeffNmax->value() });
 
-    mGA algorithm(chrom_len, fitness_function, fmask, opmask, bounds);
+    /* Don't use the selected base functions that are undefined on the whole data range for every coefficient within the bounds. */
+    std::string used_fmask = fmask;
+    std::string unused_funcs;
+    for (size_t fid = 0; fid < used_fmask.size(); fid++)
+    {
+        if (used_fmask[fid] == '1' && DomainAnalysis::isUndefined(int(fid), bounds, fitness_function.x_min(), fitness_function.x_max()))
+        {
+            used_fmask[fid] = '0';
+            unused_funcs.append("\n").append(ui->listFunctions->item(int(fid))->text().toStdString());
+        }
+    }
+    if (!ui->panelPresetF->isChecked() && !unused_funcs.empty())
+    {
+        if (used_fmask.find('1') == std::string::npos)
+        {
+            QMessageBox::critical(this, "Error", "The selected functions are undefined for every x in the data range with the coefficient bounds set.");
+            return;
+        }
+        std::string msg = "The following functions are undefined for every x in the data range with the coefficient bounds set, and are not used:";
+        QMessageBox::warning(this, "Warning", QString(msg.append(unused_funcs).c_str()));
+    }
+
+    mGA algorithm(chrom_len, fitness_function, used_fmask, opmask, bounds);
 
     /* General settings. */
     algorithm.population_size(size_t(ui->inputPopsize->value()));
@@ -200,6 +246,82 @@ void GeneticRegression::on_pushButtonRUN_clicked()
     algorithm.crossover_rate(ui->inputCxRate->value());
     algorithm.mutation_rate(ui->inputMxRate->value());
 
+    /* Choose the coefficients of the genes so their base functions are defined on the whole data range (the default fitting interval). */
+    algorithm.use_domain_constraints = true;
+
+    /* Remember the fitness of the candidates from the last few generations, the duplicates don't have to be evaluated again. */
+    algorithm.fitness_cache_size(10 * algorithm.population_size());
+
+    /*
+    * The candidates of streamed data are evaluated together in batches, each block of the data file is read once per batch
+    * while it is in the cache. The population is split into a batch for each thread, which read the same blocks at about the same time.
+    */
+    if (streamed)
+    {
+        size_t num_threads = std::max(size_t(std::thread::hardware_concurrency()), size_t(1));
+
+        algorithm.setBatchFitnessFunction([&fitness_function](const std::vector<std::vector<Gene>>& chroms)
+        {
+            return fitness_function(chroms);
+        });
+        algorithm.fitness_batch_size((algorithm.population_size() + num_threads - 1) / num_threads);
+    }
+
+    /* Stop evaluating the children that are already worse than the whole population. */
+    if (!streamed) algorithm.setRacingFitnessFunction(fitness_function);
+
+    /*
+    * Only evaluate the genes of the children that are not in their parents, the values of the other genes are taken from the records of the parents.
+    * The records of about 3 generations fit in the memory limit (at most 256 MB).
+    */
+    if (!streamed)
+    {
+        fitness_function.term_records_memory(std::min(3 * algorithm.population_size() * chrom_len * data->size() * sizeof(double), size_t(256) << 20));
+        algorithm.setIncrementalFitnessFunction([&fitness_function](const std::vector<Gene>& chrom, const std::vector<Gene>& parent, double threshold)
+        {
+            return fitness_function(chrom, parent, threshold);
+        });
+    }
+
+    /* Evaluate the candidates on a subsample of large data sets in the first part of the run (the full data set is used after 3/8 of the generations). */
+    if (ui->checkBoxSubsample->isChecked() && !streamed && data->size() >= 1024)
+    {
+        algorithm.setMultiFidelityFitnessFunction([&fitness_function](const std::vector<Gene>& chrom, double fidelity)
+        {
+            return fitness_function.evaluateSample(chrom, fidelity);
+        });
+        algorithm.fidelity_schedule(0.125, std::max(algorithm.max_gen() / 8, size_t(1)));
+    }
+
+    /*
+    * Solve the coefficients of the children that enter the function linearly by least squares instead of searching for them, if the option
+    * is checked (only with the LS and RMSE error metrics).
+    * Solving them evaluates every term of a child at every data point, so it is only done in every 4th generation.
+    */
+    FitnessFunction::Objective objective = static_cast<FitnessFunction::Objective>(ui->comboBoxObjective->currentIndex());
+    const bool fit_linear_coeffs = ui->checkBoxLinearCoeffs->isChecked() &&
+                                   (objective == FitnessFunction::Objective::LS || objective == FitnessFunction::Objective::RMSE);
+    if (fit_linear_coeffs && !streamed)
+    {
+        algorithm.repairFunction = [&fitness_function, &algorithm, bounds](const std::vector<Gene>& chrom)
+        {
+            return (algorithm.generation_cntr() % 4 == 0) ? fitness_function.fitLinearCoeffs(chrom, bounds) : chrom;
+        };
+    }
+
+    /*
+    * Polish the coefficients of the best few candidates every 10 generations: solve their linear coefficients (only if it is enabled above),
+    * then refine every coefficient with a few Levenberg-Marquardt steps. Both need values for every data point.
+    */
+    if (!streamed)
+    {
+        algorithm.setLocalSearchFunction([&fitness_function, bounds, fit_linear_coeffs](const std::vector<Gene>& chrom)
+        {
+            return fitness_function.refineCoeffs(fit_linear_coeffs ? fitness_function.fitLinearCoeffs(chrom, bounds) : chrom, bounds, 20);
+        });
+        algorithm.local_search_schedule(4, 10);
+    }
+
     /* Selection settings. */
     size_t selection_method = size_t(ui->comboBoxSelection->currentIndex());
     switch (selection_method)
@@ -309,19 +431,19 @@ void GeneticRegression::on_pushButtonRUN_clicked()
     /* Set result chart axisX range (custom interval case). */
     if (ui->panelRange->isChecked())
     {
-        auto [x_min, x_max] = axisMinMax(x, 0.0);
-        auto [fx_min, fx_max] = axisMinMax(fx_desired, 0.0);
-        ui->resultChartView->chart()->axes(Qt::Horizontal)[0]->setRange(x_min, x_max);
-        ui->resultChartView->chart()->axes(Qt::Vertical)[0]->setRange(fx_min, fx_max);
+        auto [fx_min, fx_max] = std::minmax_element(data->fx_desired(), data->fx_desired() + data->size());
+        ui->resultChartView->chart()->axes(Qt::Horizontal)[0]->setRange(fitness_function.x_min(), fitness_function.x_max());
+        ui->resultChartView->chart()->axes(Qt::Vertical)[0]->setRange(*fx_min, *fx_max);
     }
 
     auto sols = algorithm.run();
 
-    /* Display results. */
-    std::vector<Token> sol_infix = Converter::chromosomeToInfix(sols[0].chromosome);
-    std::vector<Token> sol_postfix = Converter::infixToPostfix(sol_infix);
+    /* Display results. The solution is simplified first, so the constant parts of it are displayed as single constants. */
+    std::vector<Gene> sol_simplified = Simplifier::simplify(sols[0].chromosome);
+    std::vector<Token> sol_infix = Converter::chromosomeToInfix(sol_simplified);
+    Program sol_program = Converter::chromosomeToProgram(sol_simplified);
     std::string sol_str = Printer::print(sol_infix);
-    std::vector<std::pair<double, double>> sol_points = drawFunction(sol_postfix, resultAxisX->min(), resultAxisX->max(), 1000);
+    std::vector<std::pair<double, double>> sol_points = drawFunction(sol_program, resultAxisX->min(), resultAxisX->max(), 1000);
 
     /* Display function on results chart. */
     QVector<QPointF> points;
@@ -335,15 +457,49 @@ void GeneticRegression::on_pushButtonRUN_clicked()
     /* Display function as text. */
     ui->labelResult->setText(ui->labelResult->text().append(sol_str.c_str()));
 
+    /* Display the number of candidates that were undefined at some of the data points in the tooltip of the result. */
+    std::string nan_stats = "Candidates undefined at some data points: " + std::to_string(fitness_function.num_rejected() + fitness_function.num_undefined());
+    nan_stats.append("\nRejected without evaluation: " + std::to_string(fitness_function.num_rejected()));
+
+    std::vector<size_t> rejected_funcs = fitness_function.rejected_funcs();
+    for (size_t fid = 0; fid < rejected_funcs.size(); fid++)
+    {
+        if (rejected_funcs[fid] == 0) continue;
+        nan_stats.append("\n    " + ui->listFunctions->item(int(fid))->text().toStdString() + ": " + std::to_string(rejected_funcs[fid]));
+    }
+
+    /* Also display the sensitivity of the solution to each of its coefficients, the unused coefficients are left out. */
+    std::vector<double> sensitivities = fitness_function.sensitivities(sols[0].chromosome);
+    std::string sensitivity_stats = "\n\nSensitivity of f(x) to the coefficients (RMS of the partial derivatives):";
+    for (size_t k = 0; k < sols[0].chromosome.size(); k++)
+    {
+        const Gene& gene = sols[0].chromosome[k];
+        sensitivity_stats.append("\n    " + ui->listFunctions->item(gene.fid)->text().toStdString() + ":");
+        for (size_t j = 0; j < gene.coeffs.size(); j++)
+        {
+            double sensitivity = sensitivities[k * gene.coeffs.size() + j];
+            if (sensitivity == 0.0) continue;
+            sensitivity_stats.append(std::string(" ") + "abcdn"[j] + ": " + QString::number(sensitivity, 'g', 4).toStdString());
+        }
+    }
+    ui->labelResult->setToolTip(QString((nan_stats + sensitivity_stats).c_str()));
+
     /* Display stats. */
     auto history = algorithm.soga_history();
-    fitness_best->replace(statsToPoints(history.fitness_max));
-    fitness_mean->replace(statsToPoints(history.fitness_mean));
-    fitness_sd->replace(statsToPoints(history.fitness_sd));
+    /*
+    * The fitness values evaluated on a sample of the data can't be compared to the others, so only the generations
+    * evaluated with the full fidelity are displayed (the fidelity only increases, or every generation if it wasn't reached).
+    */
+    size_t first_gen = std::find(history.fidelity.begin(), history.fidelity.end(), 1.0) - history.fidelity.begin();
+    if (first_gen == history.fidelity.size()) first_gen = 0;
+
+    fitness_best->replace(statsToPoints(history.fitness_max, first_gen));
+    fitness_mean->replace(statsToPoints(history.fitness_mean, first_gen));
+    fitness_sd->replace(statsToPoints(history.fitness_sd, first_gen));
     /* Update axis limits. */
-    auto [best_min, best_max] = axisMinMax(history.fitness_max);
-    auto [sd_min, sd_max] = axisMinMax(history.fitness_sd);
-    ui->statsChartView->chart()->axes(Qt::Horizontal)[0]->setRange(1.0, double(history.fitness_max.size()));
+    auto [best_min, best_max] = axisMinMax(std::vector<double>(history.fitness_max.begin() + first_gen, history.fitness_max.end()));
+    auto [sd_min, sd_max] = axisMinMax(std::vector<double>(history.fitness_sd.begin() + first_gen, history.fitness_sd.end()));
+    ui->statsChartView->chart()->axes(Qt::Horizontal)[0]->setRange(double(first_gen + 1), double(history.fitness_max.size()));
     ui->statsChartView->chart()->axes(Qt::Vertical)[0]->setRange(std::min(best_min, sd_min), std::max(best_max, sd_max));
     statAxisX->applyNiceNumbers();
     statAxisY->applyNiceNumbers();
@@ -361,22 +517,38 @@ void GeneticRegression::on_actionOpenData_triggered()
     QString file_name = QFileDialog::getOpenFileName(this,
                                                      "Open the data file",
                                                      QCoreApplication::applicationDirPath(),
-                                                     "(*.txt; *.csv)");
+                                                     "(*.txt; *.csv; *.grd)");
 
     if (file_name.toStdString() != "")
     {
+        /* Handle progress bar. */
+        ui->progressBar->setFormat(" Loading data %p%");
+        ui->progressBar->setValue(0);
+        ui->progressBar->setMaximum(100);
+
+        auto updateProgressBar =
+        [this](double fraction) -> void
+        {
+            ui->progressBar->setValue(int(100.0 * fraction));
+            QApplication::processEvents();
+        };
+
         try
         {
-            /* Read data points. */
-            std::tie(x_data, fx_data) = readData(file_name.toStdString());
+            /* Read data points. The double columns of binary data files are mapped instead of being read into memory. */
+            data_set = mapData(file_name.toStdString(), updateProgressBar);
         }
         catch (const std::exception& e)
         {
+            ui->progressBar->setFormat("");
+            ui->progressBar->setValue(0);
+
             std::string msg = "Couldn't read data from file.\n";
             msg.append(e.what());
             QMessageBox::critical(this, "Error", QString(msg.c_str()));
             return;
         }
+        ui->progressBar->setFormat(" Data loaded");
 
         /* Run button. */
         data_loaded = true;
@@ -388,12 +560,14 @@ void GeneticRegression::on_actionOpenData_triggered()
         file_label.append(file_name);
         ui->labelFilepath->setText(file_label);
 
-        /* Display data points on chart. */
+        /* Display data points on chart. Only some of the points of mapped data files are displayed, so they don't have to be read into memory. */
+        size_t step = data_set->mapped() ? std::max(data_set->size() / max_chart_points, size_t(1)) : 1;
+
         QVector<QPointF> points;
-        points.reserve(x_data.size());
-        for (size_t i = 0; i < x_data.size(); i++)
+        points.reserve(data_set->size() / step + 1);
+        for (size_t i = 0; i < data_set->size(); i += step)
         {
-            points.emplace_back(x_data[i], fx_data[i]);
+            points.emplace_back(data_set->x()[i], data_set->fx_desired()[i]);
         }
         data_points->replace(points);
         function_points->clear();
@@ -402,8 +576,8 @@ void GeneticRegression::on_actionOpenData_triggered()
         fitness_sd->clear();
 
         /* Update axis limits */
-        auto [x_min, x_max] = axisMinMax(x_data);
-        auto [fx_min, fx_max] = axisMinMax(fx_data);
+        auto [x_min, x_max] = axisMinMax(data_set->summary()->x_min, data_set->summary()->x_max);
+        auto [fx_min, fx_max] = axisMinMax(data_set->summary()->fx_min, data_set->summary()->fx_max);
         ui->resultChartView->chart()->axes(Qt::Horizontal)[0]->setRange(x_min, x_max);
         ui->resultChartView->chart()->axes(Qt::Vertical)[0]->setRange(fx_min, fx_max);
         resultAxisX->applyNiceNumbers();
@@ -417,6 +591,36 @@ void GeneticRegression::on_actionOpenData_triggered()
     }
 }
 
+/* Convert a text data file to a binary data file, which can be loaded without parsing it. */
+void GeneticRegression::on_actionConvertData_triggered()
+{
+    QString text_file_name = QFileDialog::getOpenFileName(this,
+                                                          "Open the data file to convert",
+                                                          QCoreApplication::applicationDirPath(),
+                                                          "(*.txt; *.csv)");
+    if (text_file_name.toStdString() == "") return;
+
+    QString binary_file_name = QFileDialog::getSaveFileName(this,
+                                                            "Save the binary data file",
+                                                            QCoreApplication::applicationDirPath(),
+                                                            "(*.grd)");
+    if (binary_file_name.toStdString() == "") return;
+
+    /* The type of the data file is determined from its extension when it is opened. */
+    if (!binary_file_name.endsWith(".grd")) binary_file_name.append(".grd");
+
+    try
+    {
+        convertData(text_file_name.toStdString(), binary_file_name.toStdString());
+    }
+    catch (const std::exception& e)
+    {
+        std::string msg = "Couldn't convert the data file.\n";
+        msg.append(e.what());
+        QMessageBox::critical(this, "Error", QString(msg.c_str()));
+    }
+}
+
 /* Save results chart as an image. */
 void GeneticRegression::on_actionSaveResults_triggered()
 {
@@ -655,8 +859,8 @@ void GeneticRegression::on_panelRange_toggled(bool on)
 {
     if (!on && data_loaded)
     {
-        auto [x_min, x_max] = axisMinMax(x_data);
-        auto [fx_min, fx_max] = axisMinMax(fx_data);
+        auto [x_min, x_max] = axisMinMax(data_set->summary()->x_min, data_set->summary()->x_max);
+        auto [fx_min, fx_max] = axisMinMax(data_set->summary()->fx_min, data_set->summary()->fx_max);
         ui->resultChartView->chart()->axes(Qt::Horizontal)[0]->setRange(x_min, x_max);
         ui->resultChartView->chart()->axes(Qt::Vertical)[0]->setRange(fx_min, fx_max);
         resultAxisX->applyNiceNumbers();
@@ -674,3 +878,9 @@ void GeneticRegression::on_inputRangeMax_valueChanged(double new_value)
     ui->inputRangeMin->setMaximum(new_value);
 }
 
+/* The coreset tolerance is only used if the points are merged. */
+void GeneticRegression::on_checkBoxCoreset_toggled(bool on)
+{
+    ui->inputCoresetTol->setEnabled(on);
+}
+
@@ -9,6 +9,9 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+
+class Dataset;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class GeneticRegression; }
@@ -29,6 +32,8 @@ private slots:
 
     void on_actionOpenData_triggered();
 
+    void on_actionConvertData_triggered();
+
     void on_actionSaveResults_triggered();
 
     void on_actionSaveStats_triggered();
@@ -84,6 +89,9 @@ private slots:
 
     void on_inputRangeMax_valueChanged(double arg1);
 
+
+    void on_checkBoxCoreset_toggled(bool on);
+
 private:
 
     Ui::GeneticRegression *ui;
@@ -92,8 +100,10 @@ private:
     bool operator_selected = true;
     bool function_selected = false;
 
-    std::vector<double> x_data;
-    std::vector<double> fx_data;
+    std::shared_ptr<const Dataset> data_set;
+
+    /* The max number of points of a mapped data file displayed on the chart, the others are skipped. */
+    static constexpr size_t max_chart_points = 100000;
 
     std::string opmask = "11000";
     std::string fmask = std::string(19, '0');
@@ -112,7 +122,8 @@ private:
     QLineSeries* fitness_mean = new QLineSeries();
     QLineSeries* fitness_sd = new QLineSeries();
 
-    QVector<QPointF> statsToPoints(const std::vector<double>& stats);
+    /* The points of the stats of the generations starting from first. */
+    QVector<QPointF> statsToPoints(const std::vector<double>& stats, size_t first = 0);
 
 };
 
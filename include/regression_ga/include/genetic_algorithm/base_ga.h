@@ -37,8 +37,13 @@
 #include <utility>
 #include <functional>
 #include <atomic>
+#include <memory>
+#include <limits>
 #include <cstddef>
 
+#include "fitness_cache.h"
+#include "thread_pool.h"
+
 /** Genetic algorithms and random number generation. */
 namespace genetic_algorithm
 {
@@ -59,10 +64,11 @@ namespace genetic_algorithm
             std::vector<double> fitness_sd;		/**< The standard deviation of the fitness values of each generation. */
             std::vector<double> fitness_min;	/**< The lowest fitness value in each generation. */
             std::vector<double> fitness_max;	/**< The highest fitness value in each generation. */
+            std::vector<double> fidelity;		/**< The fidelity the fitness values of each generation were evaluated with, only the values of the same fidelity can be compared. */
 
             void clear() noexcept;
             void reserve(size_t new_capacity);
-            void add(double mean, double sd, double min, double max);
+            void add(double mean, double sd, double min, double max, double fidelity = 1.0);
         };
 
         /** The candidates used in the algorithm, each representing a solution to the problem. */
@@ -96,6 +102,7 @@ namespace genetic_algorithm
         struct CandidateHasher
         {
             size_t operator()(const Candidate& c) const noexcept;
+            size_t operator()(const std::vector<geneType>& chrom) const noexcept;
         };
 
         using Chromosome = std::vector<geneType>;								/**< . */
@@ -105,10 +112,15 @@ namespace genetic_algorithm
         using Population = std::vector<Candidate>;								/**< . */
 
         using fitnessFunction_t = std::function<std::vector<double>(const Chromosome&)>;	/**< The type of the fitness function. */
+        using batchFitnessFunction_t = std::function<std::vector<std::vector<double>>(const std::vector<Chromosome>&)>;	/**< The type of the batch fitness function. */
+        using racingFitnessFunction_t = std::function<std::vector<double>(const Chromosome&, double)>;	/**< The type of the racing fitness function. */
+        using fidelityFitnessFunction_t = std::function<std::vector<double>(const Chromosome&, double)>;	/**< The type of the multi-fidelity fitness function. */
+        using incrementalFitnessFunction_t = std::function<std::vector<double>(const Chromosome&, const Chromosome&, double)>;	/**< The type of the incremental fitness function. */
         using selectionFunction_t = std::function<Candidate(const Population&)>;			/**< The type of the selection function. */
         using crossoverFunction_t = std::function<CandidatePair(const Candidate&, const Candidate&, double)>;	/**< The type of the crossover function. */
         using mutationFunction_t = std::function<void(Candidate&, double)>;					/**< The type of the mutation function. */
         using repairFunction_t = std::function<Chromosome(const Chromosome&)>;				/**< The type of the repair function. */
+        using localSearchFunction_t = std::function<Chromosome(const Chromosome&)>;			/**< The type of the local search function. */
         using callbackFunction_t = std::function<void(const GA*)>;
 
         /**
@@ -200,6 +212,12 @@ namespace genetic_algorithm
         /** @returns The number of fitness evaluations performed while running the algorithm. */
         [[nodiscard]] size_t num_fitness_evals() const;
 
+        /** @returns The number of fitness evaluations avoided by finding the candidates in the fitness cache while running the algorithm. @see fitness_cache_size */
+        [[nodiscard]] size_t fitness_cache_hits() const;
+
+        /** @returns The number of candidates not found in the fitness cache while running the algorithm. @see fitness_cache_size */
+        [[nodiscard]] size_t fitness_cache_misses() const;
+
         /** @returns The current value of the generation counter. */
         [[nodiscard]] size_t generation_cntr() const;
 
@@ -350,6 +368,19 @@ namespace genetic_algorithm
         void max_fitness_evals(size_t max_evals);
         [[nodiscard]] size_t max_fitness_evals() const;
 
+        /**
+        * Sets the maximum number of chromosomes whose fitness vectors are stored in the fitness cache to @p size. \n
+        * The fitness function is not called for candidates whose chromosome is found in the cache, which avoids
+        * evaluating the duplicate candidates created by the crossovers and mutations again. \n
+        * The cache is only used if the fitness function doesn't change over time. @see changing_fitness_func \n
+        * The cached evaluations are not counted in the number of fitness evaluations. \n
+        * A size of 0 disables the cache, which is the default.
+        *
+        * @param size The maximum number of chromosomes stored in the fitness cache.
+        */
+        void fitness_cache_size(size_t size);
+        [[nodiscard]] size_t fitness_cache_size() const;
+
         /**
         * Sets the reference fitness value for the fitness_value stop condition to @p ref. \n
         * The algorithm will stop running if a solution has been found which dominates this reference point. \n
@@ -400,6 +431,145 @@ namespace genetic_algorithm
         */
         void setFitnessFunction(fitnessFunction_t f);
 
+        /**
+        * Sets the batch fitness function used by the algorithm to @p f. \n
+        * If it is set, the candidates of the population that have to be evaluated are split into batches of
+        * @ref fitness_batch_size candidates, and each batch is evaluated with a single call to the batch fitness function
+        * instead of calling the fitness function for each candidate. The batches are evaluated in parallel. \n
+        * The batch fitness function should return the fitness vectors of the chromosomes in the same order,
+        * and they should be the same as the fitness vectors returned by the fitness function. \n
+        * Setting it to nullptr disables the batch evaluation, which is the default.
+        *
+        * @param f The batch fitness function to use.
+        */
+        void setBatchFitnessFunction(batchFitnessFunction_t f);
+
+        /**
+        * Sets the max number of candidates evaluated together by the batch fitness function to @p size. \n
+        * Only used if a batch fitness function is set. @see setBatchFitnessFunction \n
+        * The value of @p size must be at least 1.
+        *
+        * @param size The max number of candidates in a batch.
+        */
+        void fitness_batch_size(size_t size);
+        [[nodiscard]] size_t fitness_batch_size() const;
+
+        /**
+        * Sets the racing fitness function used by the algorithm to @p f. \n
+        * In the single-objective algorithm, a child whose fitness is lower than the fitness of the worst candidate of the
+        * current population can't survive to the next generation. If a racing fitness function is set, it is used to evaluate
+        * the children instead of the fitness function, and it is also given the fitness of the worst candidate as a threshold. \n
+        * The racing fitness function may stop evaluating a chromosome as soon as it is certain that its fitness is lower than
+        * the threshold, and return any fitness value lower than the threshold in this case. Otherwise it should return the same
+        * fitness vector as the fitness function. \n
+        * It is not used by the multi-objective algorithms, if the fitness function changes over time, or if a batch fitness function is set.
+        * Setting it to nullptr disables racing, which is the default.
+        *
+        * @param f The racing fitness function to use.
+        */
+        void setRacingFitnessFunction(racingFitnessFunction_t f);
+
+        /**
+        * Sets the multi-fidelity fitness function used by the algorithm to @p f. \n
+        * The multi-fidelity fitness function is called with a chromosome and a fidelity in (0, 1], and should return an
+        * approximation of the fitness vector of the chromosome, eg. by evaluating it on a fidelity sized fraction of the data.
+        * It should return the same fitness vector as the fitness function for a fidelity of 1. \n
+        * While the fidelity of the @ref fidelity_schedule is lower than 1, the candidates are evaluated using this function. Every time
+        * the fidelity increases, the population is evaluated again with the new fidelity. The optimal solutions are always evaluated
+        * with the fitness function before they are added to the solutions, and the final population is evaluated with the full fidelity. \n
+        * Setting it to nullptr disables the multi-fidelity evaluation, which is the default.
+        *
+        * @param f The multi-fidelity fitness function to use.
+        */
+        void setMultiFidelityFitnessFunction(fidelityFitnessFunction_t f);
+
+        /**
+        * Sets the incremental fitness function used by the algorithm to @p f. \n
+        * The incremental fitness function is called with a chromosome, the chromosome of the parent it was created from, and a threshold,
+        * so it can reuse the results of the evaluation of the parent for the parts of the chromosome that didn't change. The parent is the
+        * parent of the child sharing the most genes with it, and it is an empty chromosome for the candidates that weren't created from a parent
+        * (eg. the initial population). The threshold is the racing threshold if racing is enabled, and -infinity otherwise, and it should be
+        * handled the same way as by the racing fitness function. It should return the same fitness vector as the fitness function otherwise. \n
+        * It is used instead of the fitness function and the racing fitness function, except while the candidates are evaluated with the multi-fidelity
+        * fitness function, or if a batch fitness function is set. It is not used if the fitness function changes over time. \n
+        * Setting it to nullptr disables the incremental evaluation, which is the default.
+        *
+        * @param f The incremental fitness function to use.
+        */
+        void setIncrementalFitnessFunction(incrementalFitnessFunction_t f);
+
+        /**
+        * Sets the schedule of the fidelities used with the multi-fidelity fitness function. \n
+        * The fidelity starts from @p initial_fidelity in the first generation, and is doubled after every @p step_gens generations,
+        * until it reaches 1. Only used if a multi-fidelity fitness function is set. @see setMultiFidelityFitnessFunction \n
+        * The value of @p initial_fidelity must be in (0, 1], and @p step_gens must be at least 1.
+        *
+        * @param initial_fidelity The fidelity used in the first generation.
+        * @param step_gens The number of generations between the increases of the fidelity.
+        */
+        void fidelity_schedule(double initial_fidelity, size_t step_gens);
+
+        /** @returns The fidelity used to evaluate the current population. */
+        [[nodiscard]] double fidelity() const;
+
+        /**
+        * Sets the local search function used by the algorithm to @p f. \n
+        * The local search function is called with the chromosome of a candidate, and should return an improved chromosome of the same length
+        * (or the same chromosome if it couldn't improve it). It is applied to the best candidates of the population according to the
+        * @ref local_search_schedule, and the improved candidates are evaluated with the fitness function again. \n
+        * Unlike the repair function, which is applied to every child, it is meant for more expensive local optimization methods that
+        * would be too slow to apply to the whole population in every generation. The calls are made in parallel for the candidates. \n
+        * It is only used by the single-objective algorithm. Setting it to nullptr disables the local search, which is the default.
+        *
+        * @param f The local search function to use.
+        */
+        void setLocalSearchFunction(localSearchFunction_t f);
+
+        /**
+        * Sets the schedule of the local search. \n
+        * The local search function is applied to the @p num_candidates best candidates of the population after every @p interval_gens
+        * generations. Only used if a local search function is set. @see setLocalSearchFunction \n
+        * The values of @p num_candidates and @p interval_gens must be at least 1.
+        *
+        * @param num_candidates The number of the best candidates the local search is applied to.
+        * @param interval_gens The number of generations between the local searches.
+        */
+        void local_search_schedule(size_t num_candidates, size_t interval_gens);
+
+        /**
+        * Sets the number of threads used to run the parallel stages of the algorithm to @p num_threads. \n
+        * The threads are started by the next call to @ref run, and they are kept alive between the generations and the runs, so
+        * the algorithm doesn't have to create threads for its parallel stages. The thread calling @ref run only waits for them. \n
+        * A value of 0 uses the number of hardware threads, which is the default.
+        *
+        * @param num_threads The number of threads used by the algorithm.
+        */
+        void num_threads(size_t num_threads);
+        [[nodiscard]] size_t num_threads() const;
+
+        /**
+        * Pins the threads of the algorithm to the cores in @p cores. The i-th thread is pinned to the core cores[i % cores.size()]. \n
+        * This can be used to run several algorithms concurrently on disjoint sets of cores, so their threads don't compete for the same cores.
+        * Pinning is only supported on Windows and Linux. \n
+        * An empty vector disables pinning, which is the default.
+        *
+        * @param cores The indices of the cores the threads are pinned to.
+        */
+        void thread_affinity(std::vector<size_t> cores);
+        [[nodiscard]] std::vector<size_t> thread_affinity() const;
+
+        /**
+        * Sets the number of pairs of children created in a single task by the threads to @p size. \n
+        * Each task selects the parents, performs the crossovers, mutations and repairs, and evaluates the children. The candidates of the
+        * population are evaluated (and normalized by NSGA-III) in tasks of the same size. Larger tasks have less overhead, while smaller tasks balance the load of the
+        * threads better if the durations of the fitness evaluations are very different. \n
+        * The value of @p size must be at least 1. The default is 1.
+        *
+        * @param size The number of pairs of children created in a task.
+        */
+        void task_chunk_size(size_t size);
+        [[nodiscard]] size_t task_chunk_size() const;
+
         /* Some getters for the NSGA-III algorithm. */
         [[nodiscard]] std::vector<std::vector<double>> ref_points() const;
         [[nodiscard]] std::vector<double> ideal_point() const;
@@ -420,8 +590,12 @@ namespace genetic_algorithm
         /* Results of the GA. */
         CandidateVec solutions_;
         std::atomic<size_t> num_fitness_evals_ = 0;
+        size_t fitness_batch_size_ = 16;
         History soga_history_;
 
+        /* Fitness values of the previously evaluated chromosomes. */
+        detail::FitnessCache<Chromosome, CandidateHasher> fitness_cache_;
+
         /* Basic parameters of the GA. */
         Mode mode_ = Mode::single_objective;
         size_t chrom_len_;
@@ -451,6 +625,27 @@ namespace genetic_algorithm
 
         /* User supplied functions used in the GA. All of these are optional except for the fitness function. */
         fitnessFunction_t fitnessFunction;
+        batchFitnessFunction_t batchFitnessFunction = nullptr;
+        racingFitnessFunction_t racingFitnessFunction = nullptr;
+        fidelityFitnessFunction_t fidelityFitnessFunction = nullptr;
+        incrementalFitnessFunction_t incrementalFitnessFunction = nullptr;
+
+        /* Multi-fidelity evaluation settings. */
+        double initial_fidelity_ = 0.25;
+        size_t fidelity_step_gens_ = 10;
+        double fidelity_ = 1.0;
+
+        /* Local search settings. */
+        localSearchFunction_t localSearchFunction = nullptr;
+        size_t local_search_candidates_ = 4;
+        size_t local_search_interval_ = 10;
+
+        /* Thread settings. The thread pool is created when the algorithm is run. */
+        size_t num_threads_ = 0;
+        std::vector<size_t> thread_affinity_;
+        size_t task_chunk_size_ = 1;
+        std::unique_ptr<detail::ThreadPool> thread_pool_;
+
         selectionFunction_t customSelection = nullptr;
         crossoverFunction_t customCrossover = nullptr;
         mutationFunction_t customMutate = nullptr;
@@ -461,13 +656,20 @@ namespace genetic_algorithm
         void init();
         virtual Candidate generateCandidate() const = 0;
         Population generateInitialPopulation() const;
-        void evaluate(Population& pop);
+        void evaluate(Population& pop, double threshold = -std::numeric_limits<double>::infinity());
+        void evaluateCandidate(Candidate& sol, double threshold, const Chromosome* parent = nullptr);
+        const Chromosome& closerParent(const Candidate& child, const Candidate& parent1, const Candidate& parent2) const;
+        double racingThreshold() const;
+        void updateFidelity();
+        CandidateVec fullFidelityFront(const Population& pop);
+        void evaluateBatches(std::vector<Candidate*>& candidates);
         void updateOptimalSolutions(CandidateVec& optimal_sols, const Population& pop) const;
         void prepSelections(Population& pop) const;
         Candidate select(const Population& pop) const;
         virtual CandidatePair crossover(const Candidate& parent1, const Candidate& parent2) const = 0;
         virtual void mutate(Candidate& child) const = 0;
-        void repair(Population& pop) const;      
+        void repair(Candidate& sol) const;
+        void localSearch(Population& pop);
         Population updatePopulation(Population& old_pop, CandidateVec& children);       
         bool stopCondition() const;
         void updateStats(const Population& pop);
@@ -501,7 +703,7 @@ namespace genetic_algorithm
         static std::vector<std::vector<size_t>> nonDominatedSort(Population& pop);
 
         /* Calculate the crowding distances of the candidates in each pareto front in pfronts of the population. */
-        static void calcCrowdingDistances(Population& pop, std::vector<std::vector<size_t>>& pfronts);
+        void calcCrowdingDistances(Population& pop, std::vector<std::vector<size_t>>& pfronts) const;
 
         /* Returns true if lhs is better than rhs. */
         static bool crowdedCompare(const Candidate& lhs, const Candidate& rhs);
@@ -554,7 +756,6 @@ namespace genetic_algorithm
 
 /* IMPLEMENTATION */
 
-#include <execution>
 #include <numeric>
 #include <limits>
 #include <stdexcept>
@@ -575,6 +776,7 @@ namespace genetic_algorithm
         fitness_sd.clear();
         fitness_min.clear();
         fitness_max.clear();
+        fidelity.clear();
     }
 
     template<typename geneType>
@@ -584,15 +786,17 @@ namespace genetic_algorithm
         fitness_sd.reserve(new_capacity);
         fitness_min.reserve(new_capacity);
         fitness_max.reserve(new_capacity);
+        fidelity.reserve(new_capacity);
     }
 
     template<typename geneType>
-    inline void GA<geneType>::History::add(double mean, double sd, double min, double max)
+    inline void GA<geneType>::History::add(double mean, double sd, double min, double max, double fidelity)
     {
         fitness_mean.push_back(mean);
         fitness_sd.push_back(sd);
         fitness_min.push_back(min);
         fitness_max.push_back(max);
+        this->fidelity.push_back(fidelity);
     }
 
     template<typename geneType>
@@ -627,8 +831,14 @@ namespace genetic_algorithm
     template<typename geneType>
     inline size_t GA<geneType>::CandidateHasher::operator()(const Candidate& c) const noexcept
     {
-        size_t seed = c.chromosome.size();
-        for (const auto& gene : c.chromosome)
+        return (*this)(c.chromosome);
+    }
+
+    template<typename geneType>
+    inline size_t GA<geneType>::CandidateHasher::operator()(const std::vector<geneType>& chrom) const noexcept
+    {
+        size_t seed = chrom.size();
+        for (const auto& gene : chrom)
         {
             seed ^= std::hash<geneType>()(gene) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
         }
@@ -661,6 +871,18 @@ namespace genetic_algorithm
         return static_cast<size_t>(num_fitness_evals_);
     }
 
+    template<typename geneType>
+    inline size_t GA<geneType>::fitness_cache_hits() const
+    {
+        return fitness_cache_.hits();
+    }
+
+    template<typename geneType>
+    inline size_t GA<geneType>::fitness_cache_misses() const
+    {
+        return fitness_cache_.misses();
+    }
+
     template<typename geneType>
     inline size_t GA<geneType>::generation_cntr() const
     {
@@ -889,6 +1111,18 @@ namespace genetic_algorithm
         return max_fitness_evals_;
     }
 
+    template<typename geneType>
+    inline void GA<geneType>::fitness_cache_size(size_t size)
+    {
+        fitness_cache_.capacity(size);
+    }
+
+    template<typename geneType>
+    inline size_t GA<geneType>::fitness_cache_size() const
+    {
+        return fitness_cache_.capacity();
+    }
+
     template<typename geneType>
     inline void GA<geneType>::fitness_threshold(std::vector<double> ref)
     {
@@ -955,6 +1189,118 @@ namespace genetic_algorithm
         if (f == nullptr) throw std::invalid_argument("The fitness function can't be a nullptr.");
 
         fitnessFunction = f;
+        fitness_cache_.clear();
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::setBatchFitnessFunction(batchFitnessFunction_t f)
+    {
+        batchFitnessFunction = f;
+        fitness_cache_.clear();
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::setRacingFitnessFunction(racingFitnessFunction_t f)
+    {
+        racingFitnessFunction = f;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::setMultiFidelityFitnessFunction(fidelityFitnessFunction_t f)
+    {
+        fidelityFitnessFunction = f;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::setIncrementalFitnessFunction(incrementalFitnessFunction_t f)
+    {
+        incrementalFitnessFunction = f;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::fidelity_schedule(double initial_fidelity, size_t step_gens)
+    {
+        if (!(0.0 < initial_fidelity && initial_fidelity <= 1.0)) throw std::invalid_argument("The initial fidelity must be in (0, 1].");
+        if (step_gens == 0) throw std::invalid_argument("The number of generations between the fidelity steps must be at least 1.");
+
+        initial_fidelity_ = initial_fidelity;
+        fidelity_step_gens_ = step_gens;
+    }
+
+    template<typename geneType>
+    inline double GA<geneType>::fidelity() const
+    {
+        return fidelity_;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::setLocalSearchFunction(localSearchFunction_t f)
+    {
+        localSearchFunction = f;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::local_search_schedule(size_t num_candidates, size_t interval_gens)
+    {
+        if (num_candidates == 0) throw std::invalid_argument("The number of candidates for the local search must be at least 1.");
+        if (interval_gens == 0) throw std::invalid_argument("The number of generations between the local searches must be at least 1.");
+
+        local_search_candidates_ = num_candidates;
+        local_search_interval_ = interval_gens;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::fitness_batch_size(size_t size)
+    {
+        if (size == 0) throw std::invalid_argument("The fitness batch size must be at least 1.");
+
+        fitness_batch_size_ = size;
+    }
+
+    template<typename geneType>
+    inline size_t GA<geneType>::fitness_batch_size() const
+    {
+        return fitness_batch_size_;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::num_threads(size_t num_threads)
+    {
+        num_threads_ = num_threads;
+        thread_pool_.reset();
+    }
+
+    template<typename geneType>
+    inline size_t GA<geneType>::num_threads() const
+    {
+        return num_threads_;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::thread_affinity(std::vector<size_t> cores)
+    {
+        thread_affinity_ = std::move(cores);
+        thread_pool_.reset();
+    }
+
+    template<typename geneType>
+    inline std::vector<size_t> GA<geneType>::thread_affinity() const
+    {
+        return thread_affinity_;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::task_chunk_size(size_t size)
+    {
+        if (size == 0) throw std::invalid_argument("The task chunk size must be at least 1.");
+
+        task_chunk_size_ = size;
+    }
+
+    template<typename geneType>
+    inline size_t GA<geneType>::task_chunk_size() const
+    {
+        return task_chunk_size_;
     }
 
     template<typename geneType>
@@ -992,52 +1338,71 @@ namespace genetic_algorithm
         size_t num_children = population_size_ + population_size_ % 2;
         while (!stopCondition())
         {
-            vector<CandidatePair> parent_pairs(num_children / 2);
-
+            updateFidelity();
             prepSelections(population_);
-            if (archive_optimal_solutions) updateOptimalSolutions(solutions_, population_);
-
-            /* Selections. */
-            generate(execution::par_unseq, parent_pairs.begin(), parent_pairs.end(),
-            [this]() -> CandidatePair
+            if (archive_optimal_solutions)
             {
-                return make_pair(select(population_), select(population_));
-            });
+                if (fidelity_ < 1.0) updateOptimalSolutions(solutions_, fullFidelityFront(population_));
+                else updateOptimalSolutions(solutions_, population_);
+            }
 
-            /* Crossovers. */
-            for_each(execution::par_unseq, parent_pairs.begin(), parent_pairs.end(),
-            [this](CandidatePair& p) -> void
+            /*
+            * Each pair of children is created by a single task, which selects the parents, performs the crossover, mutates and repairs the children,
+            * and evaluates them, so the children stay in the cache of the thread. The children are evaluated separately if a batch fitness function
+            * is used, or if the fitness function changes over time (evaluate would have to evaluate them again anyway).
+            */
+            double threshold = racingThreshold();
+            bool evaluate_in_task = !changing_fitness_func && (batchFitnessFunction == nullptr || fidelity_ < 1.0);
+
+            vector<Candidate> children(num_children);
+            thread_pool_->forEachIndex(num_children / 2, task_chunk_size_,
+            [this, &children, threshold, evaluate_in_task](size_t i)
             {
-                p = crossover(p.first, p.second);
-            });
+                Candidate parent1 = select(population_);
+                Candidate parent2 = select(population_);
 
-            vector<Candidate> children;
-            children.reserve(num_children);
-            for (size_t i = 0; i < parent_pairs.size(); i++)
-            {
-                children.push_back(move(parent_pairs[i].first));
-                children.push_back(move(parent_pairs[i].second));
-            }
+                auto [child1, child2] = crossover(parent1, parent2);
 
-            /* Mutations. */
-            for_each(execution::par_unseq, children.begin(), children.end(),
-            [this](Candidate& c) -> void
-            {
-                mutate(c);
+                mutate(child1);
+                mutate(child2);
+
+                /* Apply repair function to the children if set. */
+                repair(child1);
+                repair(child2);
+
+                if (evaluate_in_task)
+                {
+                    evaluateCandidate(child1, threshold, &closerParent(child1, parent1, parent2));
+                    evaluateCandidate(child2, threshold, &closerParent(child2, parent1, parent2));
+                }
+
+                children[2 * i] = move(child1);
+                children[2 * i + 1] = move(child2);
             });
 
-            /* Apply repair function to the children if set. */
-            repair(children);
+            /* Evaluate the remaining children, and check the fitness vectors of every child. */
+            evaluate(children, threshold);
 
             /* Overwrite the current population with the children. */
-            evaluate(children);
             population_ = updatePopulation(population_, children);
 
+            /* Refine the best candidates with the local search function if set. */
+            localSearch(population_);
+
             if (endOfGenerationCallback != nullptr) endOfGenerationCallback(this);
             generation_cntr_++;
 
             updateStats(population_);
         }
+        /* The final population is evaluated with the full fidelity if it wasn't reached yet. */
+        if (fidelity_ < 1.0)
+        {
+            fidelity_ = 1.0;
+            fitness_cache_.clear();
+
+            for (auto& sol : population_) sol.is_evaluated = false;
+            evaluate(population_);
+        }
         updateOptimalSolutions(solutions_, population_);
 
         return solutions_;
@@ -1072,9 +1437,14 @@ namespace genetic_algorithm
             throw std::invalid_argument("The size of the fitness vector must be at least 2 for multi-objective optimization.");
         }
 
+        /* The threads are only created again if their settings changed. */
+        if (thread_pool_ == nullptr) thread_pool_ = std::make_unique<detail::ThreadPool>(num_threads_, thread_affinity_);
+
         /* General initialization. */
         generation_cntr_ = 0;
+        fidelity_ = (fidelityFitnessFunction != nullptr) ? initial_fidelity_ : 1.0;
         num_fitness_evals_ = 0;
+        fitness_cache_.clear();
         solutions_.clear();
         population_.clear();
 
@@ -1093,7 +1463,7 @@ namespace genetic_algorithm
         /* Generate the reference points for the NSGA-III algorithm. */
         if (mode_ == Mode::multi_objective_decomp)
         {
-            ref_points_ = detail::generateRefPoints(population_size_, num_objectives_);
+            ref_points_ = detail::generateRefPoints(population_size_, num_objectives_, *thread_pool_);
         }
     }
 
@@ -1127,21 +1497,47 @@ namespace genetic_algorithm
     }
 
     template<typename geneType>
-    inline void GA<geneType>::evaluate(Population& pop)
+    inline void GA<geneType>::evaluate(Population& pop, double threshold)
     {
         assert(fitnessFunction != nullptr);
 
-        std::for_each(std::execution::par_unseq, pop.begin(), pop.end(),
-        [this](Candidate& sol)
+        /* The cached fitness values can't be reused if the fitness function changes over time. */
+        bool use_cache = fitness_cache_.enabled() && !changing_fitness_func;
+
+        /* The candidates are evaluated with the multi-fidelity fitness function until the full fidelity is reached. */
+        bool use_fidelity = fidelity_ < 1.0;
+
+        if (batchFitnessFunction != nullptr && !use_fidelity)
         {
-            if (changing_fitness_func || !sol.is_evaluated)
+            /* Collect the candidates that have to be evaluated, and evaluate them together in batches. */
+            std::vector<Candidate*> candidates;
+            for (auto& sol : pop)
             {
-                sol.fitness = fitnessFunction(sol.chromosome);
-                sol.is_evaluated = true;
+                if (!changing_fitness_func && sol.is_evaluated) continue;
 
-                num_fitness_evals_++;
+                if (use_cache && fitness_cache_.find(sol.chromosome, sol.fitness))
+                {
+                    sol.is_evaluated = true;
+                    continue;
+                }
+                candidates.push_back(&sol);
             }
-        });
+
+            evaluateBatches(candidates);
+
+            if (use_cache)
+            {
+                for (const auto& sol : candidates) fitness_cache_.insert(sol->chromosome, sol->fitness);
+            }
+        }
+        else
+        {
+            thread_pool_->forEachIndex(pop.size(), task_chunk_size_,
+            [this, &pop, threshold](size_t i)
+            {
+                evaluateCandidate(pop[i], threshold);
+            });
+        }
 
         for (const auto& sol : pop)
         {
@@ -1156,6 +1552,141 @@ namespace genetic_algorithm
         }
     }
 
+    template<typename geneType>
+    inline void GA<geneType>::evaluateCandidate(Candidate& sol, double threshold, const Chromosome* parent)
+    {
+        assert(fitnessFunction != nullptr);
+
+        if (!changing_fitness_func && sol.is_evaluated) return;
+
+        bool use_cache = fitness_cache_.enabled() && !changing_fitness_func;
+        bool use_fidelity = fidelity_ < 1.0;
+
+        /* The candidate can only be raced against the threshold if there is one. */
+        bool use_racing = racingFitnessFunction != nullptr && threshold != -std::numeric_limits<double>::infinity() && !use_fidelity;
+
+        if (use_cache && fitness_cache_.find(sol.chromosome, sol.fitness))
+        {
+            sol.is_evaluated = true;
+            return;
+        }
+
+        if (use_fidelity) sol.fitness = fidelityFitnessFunction(sol.chromosome, fidelity_);
+        else if (incrementalFitnessFunction != nullptr && !changing_fitness_func)
+        {
+            sol.fitness = incrementalFitnessFunction(sol.chromosome, parent ? *parent : Chromosome{},
+                                                     use_racing ? threshold : -std::numeric_limits<double>::infinity());
+        }
+        else if (use_racing) sol.fitness = racingFitnessFunction(sol.chromosome, threshold);
+        else sol.fitness = fitnessFunction(sol.chromosome);
+        sol.is_evaluated = true;
+
+        num_fitness_evals_++;
+
+        /* The fitness values below the threshold might only be bounds if racing was used. */
+        bool is_exact = !use_racing || (!sol.fitness.empty() && sol.fitness[0] >= threshold);
+        if (use_cache && is_exact) fitness_cache_.insert(sol.chromosome, sol.fitness);
+    }
+
+    template<typename geneType>
+    inline const typename GA<geneType>::Chromosome& GA<geneType>::closerParent(const Candidate& child, const Candidate& parent1, const Candidate& parent2) const
+    {
+        assert(child.chromosome.size() == parent1.chromosome.size() && child.chromosome.size() == parent2.chromosome.size());
+
+        size_t same1 = 0, same2 = 0;
+        for (size_t i = 0; i < child.chromosome.size(); i++)
+        {
+            same1 += (child.chromosome[i] == parent1.chromosome[i]);
+            same2 += (child.chromosome[i] == parent2.chromosome[i]);
+        }
+
+        return (same1 >= same2) ? parent1.chromosome : parent2.chromosome;
+    }
+
+    template<typename geneType>
+    inline double GA<geneType>::racingThreshold() const
+    {
+        if (racingFitnessFunction == nullptr || batchFitnessFunction != nullptr) return -std::numeric_limits<double>::infinity();
+        if (mode_ != Mode::single_objective || changing_fitness_func) return -std::numeric_limits<double>::infinity();
+
+        /* The children with lower fitness than the worst candidate of the population can't be selected for the next population. */
+        auto worst = std::min_element(population_.begin(), population_.end(),
+        [](const Candidate& lhs, const Candidate& rhs)
+        {
+            return lhs.fitness[0] < rhs.fitness[0];
+        });
+
+        return (worst != population_.end()) ? worst->fitness[0] : -std::numeric_limits<double>::infinity();
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::updateFidelity()
+    {
+        if (fidelity_ >= 1.0) return;
+
+        assert(fidelityFitnessFunction != nullptr);
+        assert(fidelity_step_gens_ > 0);
+
+        double fidelity = std::min(initial_fidelity_ * std::pow(2.0, double(generation_cntr_ / fidelity_step_gens_)), 1.0);
+        if (fidelity == fidelity_) return;
+
+        /* The fitness values of the different fidelities can't be compared, so the population is evaluated again with the new fidelity. */
+        fidelity_ = fidelity;
+        fitness_cache_.clear();
+
+        for (auto& sol : population_) sol.is_evaluated = false;
+        evaluate(population_);
+    }
+
+    template<typename geneType>
+    inline typename GA<geneType>::CandidateVec GA<geneType>::fullFidelityFront(const Population& pop)
+    {
+        CandidateVec front = (mode_ == Mode::single_objective) ? findParetoFront1D(pop) : findParetoFrontKung(pop);
+
+        thread_pool_->forEachIndex(front.size(), 1,
+        [this, &front](size_t i)
+        {
+            front[i].fitness = fitnessFunction(front[i].chromosome);
+            num_fitness_evals_++;
+        });
+
+        return front;
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::evaluateBatches(std::vector<Candidate*>& candidates)
+    {
+        assert(batchFitnessFunction != nullptr);
+        assert(fitness_batch_size_ > 0);
+
+        size_t num_batches = (candidates.size() + fitness_batch_size_ - 1) / fitness_batch_size_;
+
+        thread_pool_->forEachIndex(num_batches, 1,
+        [this, &candidates](size_t batch_idx)
+        {
+            size_t first = batch_idx * fitness_batch_size_;
+            size_t last = std::min(first + fitness_batch_size_, candidates.size());
+
+            std::vector<Chromosome> chroms;
+            chroms.reserve(last - first);
+            for (size_t i = first; i < last; i++)
+            {
+                chroms.push_back(candidates[i]->chromosome);
+            }
+
+            std::vector<std::vector<double>> fitness = batchFitnessFunction(chroms);
+
+            /* The candidates without a fitness vector are detected by the fitness vector size check in evaluate. */
+            for (size_t i = first; i < last; i++)
+            {
+                candidates[i]->fitness = (i - first < fitness.size()) ? std::move(fitness[i - first]) : std::vector<double>{};
+                candidates[i]->is_evaluated = true;
+            }
+
+            num_fitness_evals_ += last - first;
+        });
+    }
+
     template<typename geneType>
     inline void GA<geneType>::updateOptimalSolutions(CandidateVec& optimal_sols, const Population& pop) const
     {
@@ -1215,29 +1746,64 @@ namespace genetic_algorithm
     }
 
     template<typename geneType>
-    inline void GA<geneType>::repair(Population& pop) const
+    inline void GA<geneType>::repair(Candidate& sol) const
     {
         /* This function doesn't do anything unless a repair function is specified. */
         if (repairFunction == nullptr) return;
 
-        std::for_each(std::execution::par_unseq, pop.begin(), pop.end(),
-        [this](Candidate& sol)
+        Chromosome improved_chrom = repairFunction(sol.chromosome);
+        if (improved_chrom.size() != chrom_len_)
+        {
+            throw std::domain_error("The repair function must return chromosomes of chrom_len length.");
+        }
+        if (improved_chrom != sol.chromosome)
+        {
+            sol.is_evaluated = false;
+            sol.chromosome = std::move(improved_chrom);
+        }
+    }
+
+    template<typename geneType>
+    inline void GA<geneType>::localSearch(Population& pop)
+    {
+        /* This function doesn't do anything unless a local search function is specified, and it is time for the local search. */
+        if (localSearchFunction == nullptr || mode_ != Mode::single_objective) return;
+        if ((generation_cntr_ + 1) % local_search_interval_ != 0) return;
+
+        /* Find the best candidates of the population. */
+        std::vector<Candidate*> best(pop.size());
+        std::transform(pop.begin(), pop.end(), best.begin(), [](Candidate& sol) { return &sol; });
+
+        size_t num_candidates = std::min(local_search_candidates_, best.size());
+        std::partial_sort(best.begin(), best.begin() + num_candidates, best.end(),
+        [](const Candidate* lhs, const Candidate* rhs)
+        {
+            return lhs->fitness[0] > rhs->fitness[0];
+        });
+        best.resize(num_candidates);
+
+        thread_pool_->forEachIndex(best.size(), 1,
+        [this, &best](size_t i)
         {
-            Chromosome improved_chrom = repairFunction(sol.chromosome);
-            if (improved_chrom != sol.chromosome)
+            Candidate* sol = best[i];
+            Chromosome improved_chrom = localSearchFunction(sol->chromosome);
+            if (improved_chrom != sol->chromosome)
             {
-                sol.is_evaluated = false;
-                sol.chromosome = std::move(improved_chrom);
+                sol->is_evaluated = false;
+                sol->chromosome = std::move(improved_chrom);
             }
         });
 
-        for (const auto& sol : pop)
+        for (const Candidate* sol : best)
         {
-            if (sol.chromosome.size() != chrom_len_)
+            if (sol->chromosome.size() != chrom_len_)
             {
-                throw std::domain_error("The repair function must return chromosomes of chrom_len length.");
+                throw std::domain_error("The local search function must return chromosomes of chrom_len length.");
             }
         }
+
+        /* Only the changed candidates are evaluated again. */
+        evaluate(pop);
     }
 
     template<typename geneType>
@@ -1291,7 +1857,9 @@ namespace genetic_algorithm
                 return num_fitness_evals_ >= max_fitness_evals_;
 
             case StopCondition::fitness_mean_stall:
-                if (generation_cntr_ >= stall_gen_count_)
+                /* The fitness values evaluated with different fidelities can't be compared. */
+                if (generation_cntr_ >= stall_gen_count_ &&
+                    soga_history_.fidelity[generation_cntr_] == soga_history_.fidelity[generation_cntr_ - stall_gen_count_])
                 {
                     metric_now = soga_history_.fitness_mean[generation_cntr_];
                     metric_old = soga_history_.fitness_mean[generation_cntr_ - stall_gen_count_];
@@ -1301,7 +1869,8 @@ namespace genetic_algorithm
                 else return false;
 
             case StopCondition::fitness_best_stall:
-                if (generation_cntr_ >= stall_gen_count_)
+                if (generation_cntr_ >= stall_gen_count_ &&
+                    soga_history_.fidelity[generation_cntr_] == soga_history_.fidelity[generation_cntr_ - stall_gen_count_])
                 {
                     metric_now = soga_history_.fitness_mean[generation_cntr_];
                     metric_old = soga_history_.fitness_mean[generation_cntr_ - stall_gen_count_];
@@ -1322,7 +1891,7 @@ namespace genetic_algorithm
         switch (mode_)
         {
             case Mode::single_objective:
-                soga_history_.add(fitnessMean(pop), fitnessSD(pop), fitnessMin(pop)[0], fitnessMax(pop)[0]);
+                soga_history_.add(fitnessMean(pop), fitnessSD(pop), fitnessMin(pop)[0], fitnessMax(pop)[0], fidelity_);
                 break;
             case Mode::multi_objective_sorting:
                 break;
@@ -1635,7 +2204,7 @@ namespace genetic_algorithm
     }
 
     template<typename geneType>
-    inline void GA<geneType>::calcCrowdingDistances(Population& pop, std::vector<std::vector<size_t>>& pfronts)
+    inline void GA<geneType>::calcCrowdingDistances(Population& pop, std::vector<std::vector<size_t>>& pfronts) const
     {
         using namespace std;
         assert(!pop.empty());
@@ -1648,9 +2217,11 @@ namespace genetic_algorithm
             }
         }
 
-        for_each(execution::par_unseq, pfronts.begin(), pfronts.end(),
-        [&pop](vector<size_t>& pfront)
+        thread_pool_->forEachIndex(pfronts.size(), 1,
+        [&pop, &pfronts](size_t idx)
         {
+            vector<size_t>& pfront = pfronts[idx];
+
             /* Calc the distances in each fitness dimension. */
             for (size_t d = 0; d < pop[0].fitness.size(); d++)
             {
@@ -1828,24 +2399,21 @@ namespace genetic_algorithm
 
         vector<vector<double>> fnorms(pop.size(), vector<double>(pop[0].fitness.size(), 0.0));	/* Don't change the actual fitness values. */
 
-        transform(execution::par_unseq, pop.begin(), pop.end(), fnorms.begin(), fnorms.begin(),
-        [this](const Candidate& sol, vector<double>& fnorm) -> vector<double>
+        thread_pool_->forEachIndex(pop.size(), task_chunk_size_,
+        [this, &pop, &fnorms](size_t idx)
         {
-            for (size_t i = 0; i < sol.fitness.size(); i++)
+            for (size_t i = 0; i < pop[idx].fitness.size(); i++)
             {
-                fnorm[i] = sol.fitness[i] - ideal_point_[i];
-                fnorm[i] /= min(nadir_point_[i] - ideal_point_[i], -1E-6);
+                fnorms[idx][i] = pop[idx].fitness[i] - ideal_point_[i];
+                fnorms[idx][i] /= min(nadir_point_[i] - ideal_point_[i], -1E-6);
             }
-
-            return fnorm;
         });
 
         /* Associate each candidate with the closest reference point. */
-        transform(execution::par_unseq, pop.begin(), pop.end(), fnorms.begin(), pop.begin(),
-        [&ref_points](Candidate& sol, const vector<double>& f) -> Candidate
+        thread_pool_->forEachIndex(pop.size(), task_chunk_size_,
+        [&pop, &fnorms, &ref_points](size_t idx)
         {
-            tie(sol.ref_idx, sol.distance) = detail::findClosestRef(ref_points, f);
-            return sol;
+            tie(pop[idx].ref_idx, pop[idx].distance) = detail::findClosestRef(ref_points, fnorms[idx]);
         });
     }
 
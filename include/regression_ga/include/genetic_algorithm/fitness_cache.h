@@ -0,0 +1,265 @@
+/*
+*  MIT License
+*
+*  Copyright (c) 2021 Krisztin Rugsi
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this softwareand associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright noticeand this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+/**
+* This file contains the fitness cache used by the genetic algorithms to avoid evaluating the same chromosomes multiple times.
+*
+* @file fitness_cache.h
+*/
+
+#ifndef GA_FITNESS_CACHE_H
+#define GA_FITNESS_CACHE_H
+
+#include <vector>
+#include <unordered_map>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace genetic_algorithm::detail
+{
+    /**
+    * Bounded, thread-safe cache mapping chromosomes to their fitness vectors. \n
+    * The cache is split into shards with separate locks, so the threads evaluating the candidates in parallel rarely have to wait for each other. \n
+    * Each shard stores its entries in 2 generations: new entries are added to the recent generation, and when it is full,
+    * the old generation is discarded and replaced by the recent one. Entries found in the old generation are moved back
+    * to the recent one, so the frequently used chromosomes stay in the cache (approximate LRU eviction).
+    *
+    * @tparam Key The type of the chromosomes.
+    * @tparam Hasher The hash function used for the chromosomes.
+    */
+    template<typename Key, typename Hasher>
+    class FitnessCache
+    {
+    public:
+
+        /**
+        * Create a cache storing at most @p capacity chromosomes. \n
+        * A capacity of 0 disables the cache.
+        *
+        * @param capacity The maximum number of chromosomes stored in the cache.
+        */
+        explicit FitnessCache(size_t capacity = 0);
+
+        /**
+        * Sets the maximum number of chromosomes stored in the cache to @p capacity, and clears the cache. \n
+        * A capacity of 0 disables the cache.
+        *
+        * @param capacity The maximum number of chromosomes stored in the cache.
+        */
+        void capacity(size_t capacity);
+        [[nodiscard]] size_t capacity() const noexcept;
+
+        /** @returns True if the cache is enabled (its capacity isn't 0). */
+        [[nodiscard]] bool enabled() const noexcept;
+
+        /**
+        * Look up the fitness vector of @p chrom in the cache.
+        *
+        * @param chrom The chromosome to look up.
+        * @param fitness Set to the fitness vector of the chromosome if it was found.
+        * @returns True if the chromosome was found in the cache.
+        */
+        bool find(const Key& chrom, std::vector<double>& fitness);
+
+        /**
+        * Add a chromosome and its fitness vector to the cache, possibly evicting older entries.
+        *
+        * @param chrom The chromosome.
+        * @param fitness The fitness vector of the chromosome.
+        */
+        void insert(const Key& chrom, const std::vector<double>& fitness);
+
+        /** Remove every entry from the cache and reset the hit/miss counters. */
+        void clear();
+
+        /** @returns The number of successful lookups since the last clear. */
+        [[nodiscard]] size_t hits() const noexcept;
+
+        /** @returns The number of unsuccessful lookups since the last clear. */
+        [[nodiscard]] size_t misses() const noexcept;
+
+    private:
+
+        using Map = std::unordered_map<Key, std::vector<double>, Hasher>;
+
+        struct Shard
+        {
+            std::mutex lock;
+            Map recent;
+            Map old;
+        };
+
+        static constexpr size_t max_shards = 32;
+
+        std::array<Shard, max_shards> shards_;
+        size_t capacity_ = 0;
+        size_t num_shards_ = 1;			/* The number of shards used, small caches use fewer shards so they can't exceed their capacity. */
+        size_t generation_size_ = 0;		/* The max number of entries in a generation of a shard. */
+
+        std::atomic<size_t> hits_ = 0;
+        std::atomic<size_t> misses_ = 0;
+
+        Shard& shardOf(size_t hash) noexcept;
+
+        /* Replace the old generation of shard with the recent one if the recent generation is full. */
+        void makeRoom(Shard& shard);
+    };
+
+} // namespace genetic_algorithm::detail
+
+
+/* IMPLEMENTATION */
+
+#include <algorithm>
+#include <utility>
+
+namespace genetic_algorithm::detail
+{
+    template<typename Key, typename Hasher>
+    inline FitnessCache<Key, Hasher>::FitnessCache(size_t capacity)
+    {
+        this->capacity(capacity);
+    }
+
+    template<typename Key, typename Hasher>
+    inline void FitnessCache<Key, Hasher>::capacity(size_t capacity)
+    {
+        clear();
+
+        capacity_ = capacity;
+        /* Each shard used stores at least 1 entry per generation, so the number of shards is limited by the capacity. */
+        num_shards_ = std::clamp(capacity / 2, size_t(1), max_shards);
+        /* Each shard stores at most 2 generations, so the total number of entries is at most the capacity
+        *  (a cache with a capacity of 1 doesn't keep an old generation, see makeRoom). */
+        generation_size_ = std::max(capacity / (2 * num_shards_), size_t(1));
+    }
+
+    template<typename Key, typename Hasher>
+    inline size_t FitnessCache<Key, Hasher>::capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    template<typename Key, typename Hasher>
+    inline bool FitnessCache<Key, Hasher>::enabled() const noexcept
+    {
+        return capacity_ != 0;
+    }
+
+    template<typename Key, typename Hasher>
+    inline bool FitnessCache<Key, Hasher>::find(const Key& chrom, std::vector<double>& fitness)
+    {
+        if (!enabled()) return false;
+
+        size_t hash = Hasher()(chrom);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        if (auto it = shard.recent.find(chrom); it != shard.recent.end())
+        {
+            fitness = it->second;
+            hits_++;
+            return true;
+        }
+        if (auto it = shard.old.find(chrom); it != shard.old.end())
+        {
+            fitness = it->second;
+            hits_++;
+
+            /* Move the entry to the recent generation, so it isn't evicted with the old generation. */
+            auto node = shard.old.extract(it);
+            makeRoom(shard);
+            shard.recent.insert(std::move(node));
+
+            return true;
+        }
+
+        misses_++;
+        return false;
+    }
+
+    template<typename Key, typename Hasher>
+    inline void FitnessCache<Key, Hasher>::insert(const Key& chrom, const std::vector<double>& fitness)
+    {
+        if (!enabled()) return;
+
+        size_t hash = Hasher()(chrom);
+        Shard& shard = shardOf(hash);
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        /* Another thread could have added the same chromosome since it was looked up. */
+        if (shard.recent.contains(chrom) || shard.old.contains(chrom)) return;
+
+        makeRoom(shard);
+        shard.recent.emplace(chrom, fitness);
+    }
+
+    template<typename Key, typename Hasher>
+    inline void FitnessCache<Key, Hasher>::clear()
+    {
+        for (auto& shard : shards_)
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            shard.recent.clear();
+            shard.old.clear();
+        }
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+    template<typename Key, typename Hasher>
+    inline size_t FitnessCache<Key, Hasher>::hits() const noexcept
+    {
+        return static_cast<size_t>(hits_);
+    }
+
+    template<typename Key, typename Hasher>
+    inline size_t FitnessCache<Key, Hasher>::misses() const noexcept
+    {
+        return static_cast<size_t>(misses_);
+    }
+
+    template<typename Key, typename Hasher>
+    inline typename FitnessCache<Key, Hasher>::Shard& FitnessCache<Key, Hasher>::shardOf(size_t hash) noexcept
+    {
+        /* The maps use the low bits of the hashes, so the shards are selected based on the high bits of the mixed hash. */
+        return shards_[((uint64_t(hash) * 0x9e3779b97f4a7c15) >> 32) % num_shards_];
+    }
+
+    template<typename Key, typename Hasher>
+    inline void FitnessCache<Key, Hasher>::makeRoom(Shard& shard)
+    {
+        if (shard.recent.size() >= generation_size_)
+        {
+            if (capacity_ > 1) shard.old = std::move(shard.recent);
+            shard.recent.clear();
+        }
+    }
+
+} // namespace genetic_algorithm::detail
+
+#endif // !GA_FITNESS_CACHE_H
\ No newline at end of file
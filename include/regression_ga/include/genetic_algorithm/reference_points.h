@@ -33,13 +33,15 @@
 #include <vector>
 #include <cstddef>
 
+#include "thread_pool.h"
+
 namespace genetic_algorithm::detail
 {
     /* Sample a point from a uniform distribution on a unit simplex in dim dimensions. */
     inline std::vector<double> randomSimplexPoint(size_t dim);
 
-    /* Generate n reference points on the unit simplex in dim dimensions (for the NSGA-III algorithm). */
-    inline std::vector<std::vector<double>> generateRefPoints(size_t n, size_t dim);
+    /* Generate n reference points on the unit simplex in dim dimensions (for the NSGA-III algorithm), using the threads of pool. */
+    inline std::vector<std::vector<double>> generateRefPoints(size_t n, size_t dim, ThreadPool& pool);
 
 } // namespace genetic_algorithm::detail
 
@@ -47,7 +49,6 @@ namespace genetic_algorithm::detail
 /* IMPLEMENTATION */
 
 #include <algorithm>
-#include <execution>
 #include <random>
 #include <limits>
 #include <cmath>
@@ -81,7 +82,7 @@ namespace genetic_algorithm::detail
         return point;
     }
 
-    std::vector<std::vector<double>> generateRefPoints(size_t n, size_t dim)
+    std::vector<std::vector<double>> generateRefPoints(size_t n, size_t dim, ThreadPool& pool)
     {
         using namespace std;
         assert(n > 0);
@@ -101,12 +102,12 @@ namespace genetic_algorithm::detail
         vector<double> min_distances(candidates.size(), numeric_limits<double>::infinity());
         while (refs.size() < n)
         {
-            /* Calc the distance of each candidate to the closest ref point. */
-            transform(execution::par_unseq, candidates.begin(), candidates.end(), min_distances.begin(), min_distances.begin(),
-            [&refs](const vector<double>& candidate, double dmin)
+            /* Calc the distance of each candidate to the closest ref point. The distances are cheap to calculate, so they are computed in chunks of 64. */
+            pool.forEachIndex(candidates.size(), 64,
+            [&refs, &candidates, &min_distances](size_t i)
             {
-                double d = euclideanDistanceSq(candidate, refs.back());
-                return min(dmin, d);
+                double d = euclideanDistanceSq(candidates[i], refs.back());
+                min_distances[i] = min(min_distances[i], d);
             });
 
             /* Add the candidate with highest min_distance to the refs. */
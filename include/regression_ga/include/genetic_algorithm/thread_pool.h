@@ -0,0 +1,331 @@
+/*
+*  MIT License
+*
+*  Copyright (c) 2021 Krisztin Rugsi
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this softwareand associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright noticeand this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+/**
+* This file contains the thread pool used by the genetic algorithms to run their parallel stages.
+*
+* @file thread_pool.h
+*/
+
+#ifndef GA_THREAD_POOL_H
+#define GA_THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <cstddef>
+
+namespace genetic_algorithm::detail
+{
+    /**
+    * Persistent, work-stealing thread pool. \n
+    * The worker threads are started when the pool is created, and they wait for tasks until it is destroyed, so no threads are
+    * created for the parallel loops. Each worker has its own queue of tasks: the workers take the tasks from the back of their own queue,
+    * and when it is empty, they steal tasks from the front of the queues of the other workers. This balances the load of the workers
+    * even if the durations of the tasks are very different (eg. when the fitness evaluations of some candidates are stopped early). \n
+    * The worker threads can be pinned to a set of cores, so several pools can run concurrently on disjoint sets of cores.
+    */
+    class ThreadPool
+    {
+    public:
+
+        /**
+        * Create a thread pool with @p num_threads worker threads. \n
+        * If @p num_threads is 0, the number of hardware threads is used. \n
+        * If @p cores is not empty, the i-th worker thread is pinned to the core cores[i % cores.size()]. Pinning is only
+        * supported on Windows and Linux, and it is ignored if the operating system doesn't allow it.
+        *
+        * @param num_threads The number of worker threads.
+        * @param cores The indices of the cores the worker threads are pinned to.
+        */
+        explicit ThreadPool(size_t num_threads = 0, const std::vector<size_t>& cores = {});
+
+        /** Stop the worker threads. There can't be any loops running on the pool when it is destroyed. */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /** @returns The number of worker threads of the pool. */
+        [[nodiscard]] size_t num_threads() const noexcept;
+
+        /**
+        * Call @p f(i) for each index i in [0, @p n) on the worker threads, and wait for every call to finish. \n
+        * The indices are split into tasks of @p chunk_size consecutive indices, and each task is executed by a single worker. \n
+        * The thread calling this function doesn't execute any of the tasks unless it is a worker of the pool (the loop is nested
+        * in a task), in which case it executes the tasks while it is waiting. \n
+        * If any of the calls throws an exception, the remaining tasks are still executed, and the first exception is rethrown
+        * after all of them have finished.
+        *
+        * @param n The number of indices.
+        * @param chunk_size The number of indices in a task. Must be at least 1.
+        * @param f The function called for each index.
+        */
+        template<typename F>
+        void forEachIndex(size_t n, size_t chunk_size, F&& f);
+
+    private:
+
+        /* A call of forEachIndex. */
+        struct Job
+        {
+            void (*invoke)(void* f, size_t first, size_t last) = nullptr;
+            void* f = nullptr;
+
+            std::atomic<size_t> remaining = 0;		/* The number of tasks of the job that haven't been finished yet. */
+
+            std::mutex exception_lock;
+            std::exception_ptr exception = nullptr;
+        };
+
+        /* The indices [first, last) of a job. */
+        struct Task
+        {
+            Job* job;
+            size_t first;
+            size_t last;
+        };
+
+        struct Queue
+        {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::thread> workers_;
+        std::vector<std::unique_ptr<Queue>> queues_;	/* The task queue of each worker. */
+
+        std::mutex lock_;
+        std::condition_variable task_added_;
+        std::atomic<size_t> num_tasks_ = 0;			/* The number of tasks in the queues. */
+        bool stop_ = false;
+
+        std::mutex job_lock_;
+        std::condition_variable job_finished_;
+
+        /* The pool and the index of the worker running on the current thread. */
+        static inline thread_local const ThreadPool* current_pool_ = nullptr;
+        static inline thread_local size_t current_worker_ = 0;
+
+        void submit(Job& job, size_t n, size_t chunk_size);
+        void workerLoop(size_t worker_idx, size_t core, bool pin);
+
+        /* Execute a task from the queue of the worker if there is one, otherwise steal one from the other queues. Returns false if there were no tasks. */
+        bool runTask(size_t worker_idx);
+        void execute(const Task& task);
+
+        static void pinThread(size_t core);
+    };
+
+} // namespace genetic_algorithm::detail
+
+
+/* IMPLEMENTATION */
+
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace genetic_algorithm::detail
+{
+    inline ThreadPool::ThreadPool(size_t num_threads, const std::vector<size_t>& cores)
+    {
+        if (num_threads == 0) num_threads = std::max(size_t(std::thread::hardware_concurrency()), size_t(1));
+
+        queues_.reserve(num_threads);
+        for (size_t i = 0; i < num_threads; i++)
+        {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+
+        workers_.reserve(num_threads);
+        for (size_t i = 0; i < num_threads; i++)
+        {
+            size_t core = cores.empty() ? 0 : cores[i % cores.size()];
+            workers_.emplace_back(&ThreadPool::workerLoop, this, i, core, !cores.empty());
+        }
+    }
+
+    inline ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+        }
+        task_added_.notify_all();
+
+        for (auto& worker : workers_) worker.join();
+    }
+
+    inline size_t ThreadPool::num_threads() const noexcept
+    {
+        return workers_.size();
+    }
+
+    template<typename F>
+    inline void ThreadPool::forEachIndex(size_t n, size_t chunk_size, F&& f)
+    {
+        assert(chunk_size > 0);
+
+        if (n == 0) return;
+
+        Job job;
+        job.f = static_cast<void*>(std::addressof(f));
+        job.invoke = [](void* f, size_t first, size_t last)
+        {
+            auto& func = *static_cast<std::remove_reference_t<F>*>(f);
+            for (size_t i = first; i < last; i++) func(i);
+        };
+
+        submit(job, n, chunk_size);
+
+        /* A worker can't just wait for the job, because the tasks of the job might be in its own queue. */
+        if (current_pool_ == this)
+        {
+            while (job.remaining != 0 && runTask(current_worker_)) {}
+        }
+
+        std::unique_lock<std::mutex> lock(job_lock_);
+        job_finished_.wait(lock, [&job] { return job.remaining == 0; });
+
+        if (job.exception) std::rethrow_exception(job.exception);
+    }
+
+    inline void ThreadPool::submit(Job& job, size_t n, size_t chunk_size)
+    {
+        size_t num_tasks = (n + chunk_size - 1) / chunk_size;
+        job.remaining = num_tasks;
+
+        /* The counter is increased before the tasks are added, so it can't underflow when a worker takes a task before it would be counted. */
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            num_tasks_ += num_tasks;
+        }
+
+        /* Distribute the tasks evenly between the queues, the workers will steal them from each other as needed. */
+        for (size_t q = 0; q < queues_.size() && q < num_tasks; q++)
+        {
+            std::lock_guard<std::mutex> guard(queues_[q]->lock);
+            for (size_t t = q; t < num_tasks; t += queues_.size())
+            {
+                queues_[q]->tasks.push_back({ &job, t * chunk_size, std::min((t + 1) * chunk_size, n) });
+            }
+        }
+        task_added_.notify_all();
+    }
+
+    inline void ThreadPool::workerLoop(size_t worker_idx, size_t core, bool pin)
+    {
+        current_pool_ = this;
+        current_worker_ = worker_idx;
+
+        if (pin) pinThread(core);
+
+        while (true)
+        {
+            if (runTask(worker_idx)) continue;
+
+            std::unique_lock<std::mutex> lock(lock_);
+            task_added_.wait(lock, [this] { return stop_ || num_tasks_ != 0; });
+            if (stop_) return;
+        }
+    }
+
+    inline bool ThreadPool::runTask(size_t worker_idx)
+    {
+        for (size_t i = 0; i < queues_.size(); i++)
+        {
+            Queue& queue = *queues_[(worker_idx + i) % queues_.size()];
+
+            std::unique_lock<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty()) continue;
+
+            /* The own queue is used from the back, so the tasks are stolen in the order they were added. */
+            Task task = (i == 0) ? queue.tasks.back() : queue.tasks.front();
+            if (i == 0) queue.tasks.pop_back();
+            else queue.tasks.pop_front();
+            guard.unlock();
+
+            num_tasks_--;
+            execute(task);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    inline void ThreadPool::execute(const Task& task)
+    {
+        Job& job = *task.job;
+        try
+        {
+            job.invoke(job.f, task.first, task.last);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(job.exception_lock);
+            if (!job.exception) job.exception = std::current_exception();
+        }
+
+        /* The job can be destroyed by the thread waiting for it as soon as its last task is finished, so it can't be used after this. */
+        if (job.remaining.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> guard(job_lock_);
+            job_finished_.notify_all();
+        }
+    }
+
+    inline void ThreadPool::pinThread([[maybe_unused]] size_t core)
+    {
+#ifdef _WIN32
+        if (core < 8 * sizeof(DWORD_PTR)) SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+        if (core >= CPU_SETSIZE) return;
+
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(core, &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#endif
+    }
+
+} // namespace genetic_algorithm::detail
+
+#endif // !GA_THREAD_POOL_H
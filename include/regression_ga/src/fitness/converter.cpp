@@ -2,12 +2,13 @@
 
 #include "converter.h"
 #include "token.h"
+#include "program.h"
 #include "math_ops.h"
 #include "../genetic/gene.h"
 
+#include <algorithm>
 #include <vector>
-#include <stack>
-#include <utility>
+#include <array>
 #include <cstddef>
 #include <cassert>
 
@@ -30,35 +31,65 @@ std::vector<Token> Converter::chromosomeToInfix(const std::vector<Gene>& chrom)
     return infix_expr;
 }
 
-std::vector<Token> Converter::infixToPostfix(const std::vector<Token>& infix_expr)
+Program Converter::chromosomeToProgram(const std::vector<Gene>& chrom)
 {
-    std::vector<Token> postfix_expr;
-    std::stack<Token> operator_stack;
-    postfix_expr.reserve(infix_expr.size());
+    Program program;
+    chromosomeToProgram(chrom, program);
 
-    for (const auto& token : infix_expr)
+    return program;
+}
+
+void Converter::chromosomeToProgram(const std::vector<Gene>& chrom, Program& program)
+{
+    assert(chrom.size() > 0);
+
+    program.code.clear();
+    program.code.reserve(2 * chrom.size() - 1);
+    program.max_depth = 0;
+
+    /*
+    * The precedents of the operators on the stack are strictly increasing, so the
+    * stack can't hold more operators than the number of different precedent levels.
+    */
+    std::array<int, 3> operator_stack;
+    size_t num_operators = 0;
+
+    /* Track the size of the operand stack during the evaluation of the program. */
+    size_t depth = 0;
+
+    for (size_t i = 0; i < chrom.size(); i++)
     {
         /* Operand. */
-        if (!token.is_operator)
-        {
-            postfix_expr.push_back(token);
-        }
+        Instruction& operand = program.code.emplace_back();
+        operand.is_operator = false;
+        operand.fid = chrom[i].fid;
+        operand.opid = _OP_MIN;
+        operand.coeffs = chrom[i].coeffs;
+
+        program.max_depth = std::max(program.max_depth, ++depth);
+
+        /* The operator in the last gene is discarded. */
+        if (i == chrom.size() - 1) break;
+
         /* Operator. */
-        else
+        while (num_operators > 0 && precedent(operator_stack[num_operators - 1]) >= precedent(chrom[i].opid))
         {
-            while (!operator_stack.empty() && precedent(operator_stack.top().opid) >= precedent(token.opid))
-            {
-                postfix_expr.push_back(std::move(operator_stack.top()));
-                operator_stack.pop();
-            }
-            operator_stack.push(token);
+            Instruction& op = program.code.emplace_back();
+            op.is_operator = true;
+            op.fid = 0;
+            op.opid = operator_stack[--num_operators];
+            depth--;
         }
+        assert(num_operators < operator_stack.size());
+        operator_stack[num_operators++] = chrom[i].opid;
     }
-    while (!operator_stack.empty())
+    while (num_operators > 0)
     {
-        postfix_expr.push_back(std::move(operator_stack.top()));
-        operator_stack.pop();
+        Instruction& op = program.code.emplace_back();
+        op.is_operator = true;
+        op.fid = 0;
+        op.opid = operator_stack[--num_operators];
+        depth--;
     }
-
-    return postfix_expr;
+    assert(depth == 1);
 }
\ No newline at end of file
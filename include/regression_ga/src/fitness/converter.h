@@ -1,7 +1,7 @@
 /* Copyright (c) 2021 Krisztin Rugsi. */
 
 /*
-* Functions to perform conversions between: chromosomes of the GA, infix expressions, postfix expressions.
+* Functions to perform conversions between: chromosomes of the GA, infix expressions, compiled postfix programs.
 * These function are used during fitness evaluation in the decoding process (and for printing the results).
 */
 
@@ -9,12 +9,13 @@
 #define CONVERTER_H
 
 #include "token.h"
+#include "program.h"
 #include "../genetic/gene.h"
 
 #include <vector>
 
 
-/* Conversions between chromosomes, infix, and postfix expressions. */
+/* Conversions between chromosomes, infix expressions, and programs. */
 class Converter
 {
 public:
@@ -22,8 +23,11 @@ public:
     /* Convert a chromosome of a solution in the GA to an infix expression. */
     static std::vector<Token> chromosomeToInfix(const std::vector<Gene>& chrom);
 
-    /* Convert an infix expression to a postfix expression for evaluation. */
-    static std::vector<Token> infixToPostfix(const std::vector<Token>& infix_expr);
+    /* Compile a chromosome of a solution in the GA to a postfix program for evaluation. */
+    static Program chromosomeToProgram(const std::vector<Gene>& chrom);
+
+    /* Compile a chromosome into an existing program, reusing its storage. */
+    static void chromosomeToProgram(const std::vector<Gene>& chrom, Program& program);
 
 };
 
@@ -0,0 +1,79 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+#include "coreset.h"
+#include "dataset.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
+
+
+std::shared_ptr<const Dataset> Coreset::build(const Dataset& data, double tolerance)
+{
+    assert(tolerance >= 0.0);
+    assert(data.size() > 0);
+
+    const size_t num_points = data.size();
+    const double* x = data.x();
+    const double* fx_desired = data.fx_desired();
+    const double* weights = data.weights();
+
+    /* Visit the points in ascending order of x. The files of measurements are usually sorted already. */
+    std::vector<size_t> order(num_points);
+    std::iota(order.begin(), order.end(), size_t(0));
+    if (!std::is_sorted(x, x + num_points))
+    {
+        std::stable_sort(order.begin(), order.end(), [x](size_t lhs, size_t rhs) { return x[lhs] < x[rhs]; });
+    }
+
+    auto [x_min, x_max] = std::minmax_element(x, x + num_points);
+    const double max_width = max_bin_width * (*x_max - *x_min);
+
+    std::vector<double> coreset_x, coreset_fx, coreset_weights;
+    for (size_t first = 0; first < num_points; )
+    {
+        /*
+        * Extend the bin while the fx values in it are within tolerance of each other. The undefined points are not merged, and neither are
+        * the first and last points, so the coreset spans the same range of x as data (the domain constraints of the genes depend on it).
+        */
+        double fx_min = fx_desired[order[first]];
+        double fx_max = fx_desired[order[first]];
+
+        size_t last = first + 1;
+        for (; first != 0 && last < num_points - 1; last++)
+        {
+            const size_t idx = order[last];
+
+            double lo = std::min(fx_min, fx_desired[idx]);
+            double hi = std::max(fx_max, fx_desired[idx]);
+
+            if (!(hi - lo <= tolerance) || std::isnan(fx_desired[idx]) || x[idx] - x[order[first]] > max_width) break;
+
+            fx_min = lo;
+            fx_max = hi;
+        }
+
+        double weight_sum = 0.0, x_sum = 0.0, fx_sum = 0.0;
+        for (size_t i = first; i < last; i++)
+        {
+            const size_t idx = order[i];
+            const double w = weights ? weights[idx] : 1.0;
+
+            weight_sum += w;
+            x_sum += w * x[idx];
+            fx_sum += w * fx_desired[idx];
+        }
+        coreset_x.push_back(x_sum / weight_sum);
+        coreset_fx.push_back(fx_sum / weight_sum);
+        coreset_weights.push_back(weight_sum);
+
+        first = last;
+    }
+
+    return std::make_shared<const Dataset>(std::move(coreset_x), std::move(coreset_fx), std::move(coreset_weights));
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/* Compression of the data points into a smaller set of weighted points, so the fitness function can be evaluated at fewer points. */
+
+#ifndef CORESET_H
+#define CORESET_H
+
+#include "dataset.h"
+
+#include <memory>
+
+
+/* Builds weighted coresets of the data points for the fitness function. */
+class Coreset
+{
+public:
+
+    /*
+    * Returns a weighted coreset of data. The points that are adjacent in the order of their x values are merged into a single point while
+    * their fx values are within tolerance of each other, and their x values span at most max_bin_width part of the range of x.
+    * The merged point is the weighted mean of the points, and its weight is the sum of their weights.
+    * If a function changes by at most e over each bin, its error at each of the original points is within tolerance + e of its error at the
+    * merged point, so the weighted error metrics over the coreset approximate the error metrics over data.
+    * The points of the coreset are in ascending order of x. A tolerance of 0 only merges the points with the same fx values.
+    */
+    static std::shared_ptr<const Dataset> build(const Dataset& data, double tolerance);
+
+private:
+
+    /* The max width of the range of the x values merged into a point, relative to the range of every x value. */
+    static constexpr double max_bin_width = 0.01;
+};
+
+#endif // !CORESET_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+#include "dataset.h"
+
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <cstddef>
+#include <cassert>
+
+
+Dataset::Dataset(std::vector<double> x, std::vector<double> fx_desired) :
+    x_storage_(std::move(x)),
+    fx_desired_storage_(std::move(fx_desired)),
+    x_(x_storage_.data()),
+    fx_desired_(fx_desired_storage_.data()),
+    size_(x_storage_.size())
+{
+    assert(x_storage_.size() == fx_desired_storage_.size());
+}
+
+Dataset::Dataset(std::vector<double> x, std::vector<double> fx_desired, std::vector<double> weights) :
+    Dataset(std::move(x), std::move(fx_desired))
+{
+    assert(weights.size() == size_);
+    assert(std::all_of(weights.begin(), weights.end(), [](double w) { return w > 0.0; }));
+
+    weights_storage_ = std::move(weights);
+    weights_ = weights_storage_.data();
+}
+
+Dataset::Dataset(const double* x, const double* fx_desired, size_t num_points, std::shared_ptr<const void> owner) :
+    owner_(std::move(owner)),
+    x_(x),
+    fx_desired_(fx_desired),
+    size_(num_points)
+{
+    assert(x != nullptr && fx_desired != nullptr);
+}
+
+void Dataset::summary(const Summary& summary) noexcept
+{
+    assert(summary.x_min <= summary.x_max && summary.fx_min <= summary.fx_max);
+
+    summary_ = summary;
+}
+
+size_t Dataset::size() const noexcept
+{
+    return size_;
+}
+
+const double* Dataset::x() const noexcept
+{
+    return x_;
+}
+
+const double* Dataset::fx_desired() const noexcept
+{
+    return fx_desired_;
+}
+
+const double* Dataset::weights() const noexcept
+{
+    return weights_;
+}
+
+bool Dataset::mapped() const noexcept
+{
+    return owner_ != nullptr;
+}
+
+const std::optional<Dataset::Summary>& Dataset::summary() const noexcept
+{
+    return summary_;
+}
\ No newline at end of file
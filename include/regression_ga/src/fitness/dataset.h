@@ -0,0 +1,77 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/* The data points used by the fitness function. */
+
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstddef>
+
+
+/*
+* The data points the fitness function is evaluated at, stored as a column of the x values and a column of the fx values,
+* and optionally a column of the weights of the points (eg. the number of original points merged into each point of a coreset).
+* The columns are either owned by the dataset, or they view memory owned by another object, which is kept alive by the dataset.
+* When they view a memory mapped file, the points don't have to fit in memory: the fitness function reads them in consecutive blocks,
+* so only the pages of the blocks being evaluated are loaded by the OS, and they can be evicted again after they were used.
+* (The term cache and FitnessFunction::fitLinearCoeffs store values for every point, so they shouldn't be used with such data.)
+*/
+class Dataset
+{
+public:
+
+    /* Contructors. */
+    Dataset() = delete;
+
+    /* Create a dataset owning the points. */
+    Dataset(std::vector<double> x, std::vector<double> fx_desired);
+
+    /* Create a dataset owning the points and their weights, which must be positive. */
+    Dataset(std::vector<double> x, std::vector<double> fx_desired, std::vector<double> weights);
+
+    /* Create a dataset viewing the num_points values starting at x and fx_desired, which are kept valid by owner. */
+    Dataset(const double* x, const double* fx_desired, size_t num_points, std::shared_ptr<const void> owner);
+
+    /* The ranges of the columns and whether the x values are in ascending order, if they are known without reading every point. */
+    struct Summary
+    {
+        double x_min, x_max;
+        double fx_min, fx_max;
+        bool x_sorted;
+    };
+
+    /* Setters. The summary must match the points, it is used instead of calculating the same values from them. */
+    void summary(const Summary& summary) noexcept;
+
+    /* Getters. */
+    size_t size() const noexcept;
+    const double* x() const noexcept;
+    const double* fx_desired() const noexcept;
+
+    /* The weights of the points, or nullptr if every point has the same weight. */
+    const double* weights() const noexcept;
+
+    /* True if the points are viewed in memory owned by another object (a memory mapped file), instead of being owned by the dataset. */
+    bool mapped() const noexcept;
+
+    /* The summary of the points if it is known, eg. from the header of a binary data file. */
+    const std::optional<Summary>& summary() const noexcept;
+
+private:
+
+    std::vector<double> x_storage_;             /* The x values if they are owned by the dataset. */
+    std::vector<double> fx_desired_storage_;    /* The fx values if they are owned by the dataset. */
+    std::vector<double> weights_storage_;       /* The weights of the points if they are weighted. */
+    std::shared_ptr<const void> owner_;         /* The owner of the values if they are not owned by the dataset. */
+
+    const double* x_;
+    const double* fx_desired_;
+    const double* weights_ = nullptr;
+    size_t size_;
+    std::optional<Summary> summary_;
+};
+
+#endif // !DATASET_H
\ No newline at end of file
@@ -1,166 +1,224 @@
 /* Copyright (c) 2021 Krisztin Rugsi. */
 
 #include "decoder.h"
-#include "token.h"
+#include "program.h"
 #include "math_ops.h"
+#include "vector_math.h"
 
+#include <algorithm>
 #include <vector>
-#include <stack>
 #include <cmath>
 #include <cstddef>
 #include <cassert>
+#include <cstdlib>
 
 
-std::vector<double> Decoder::evalToken(const Token& token, const std::vector<double>& x)
+void Decoder::evalOperand(const Instruction& operand, const double* x, double* fx, size_t n, Precision precision, bool x_sorted)
 {
-    assert(!token.is_operator);
-    assert(token.coeffs.size() >= 5);
-    assert(token.fid < base_functions.size());
+    assert(!operand.is_operator);
+    assert(size_t(operand.fid) < base_functions.size());
 
-    return base_functions[token.fid](x, token.coeffs);
+    if (x_sorted && base_functions[operand.fid] == sgn)
+    {
+        sgnSorted(x, fx, n, operand.coeffs);
+        return;
+    }
+
+    switch (precision)
+    {
+        case Precision::exact:
+            base_functions[operand.fid](x, fx, n, operand.coeffs);
+            break;
+        case Precision::fast:
+            fast_base_functions[operand.fid](x, fx, n, operand.coeffs);
+            break;
+        default:
+            assert(false);	/* Invalid precision. Shouldn't get here. */
+            std::abort();
+    }
+}
+
+void Decoder::evalOperator(const Instruction& op, double* lhs, const double* rhs, size_t n, Precision precision)
+{
+    assert(op.is_operator);
+
+    /* The exponent is usually a constant term, so it is the same at every point. */
+    if (precision == Precision::fast && op.opid == OP_POW && n > 0 && std::all_of(rhs, rhs + n, [y = rhs[0]](double v) { return v == y; }))
+    {
+        fastPow(lhs, lhs, n, rhs[0]);
+        return;
+    }
+
+    performOperation(lhs, rhs, n, op.opid);
+}
+
+std::vector<double> Decoder::evalProgram(const Program& program, const std::vector<double>& x, Precision precision)
+{
+    const double* fx = evalProgram(program, x.data(), x.size(), precision);
+
+    return std::vector<double>(fx, fx + x.size());
+}
+
+double* Decoder::registers(size_t size)
+{
+    /* The registers are reused by every evaluation on the same thread, they only grow when a longer program or more points are evaluated. */
+    thread_local std::vector<double> registers;
+    if (registers.size() < size)
+    {
+        registers.resize(size);
+    }
+
+    return registers.data();
 }
 
-std::vector<double> Decoder::evalPostfixExpr(const std::vector<Token>& postfix_expr, const std::vector<double>& x)
+const double* Decoder::evalProgram(const Program& program, const double* x, size_t n, Precision precision, bool x_sorted)
 {
-    std::stack<std::vector<double>> operand_stack;
+    double* regs = registers(program.max_depth * n);
 
-    for (const auto& token : postfix_expr)
+    size_t top = 0;     /* The number of registers in use (the size of the operand stack). */
+    for (const auto& instruction : program.code)
     {
         /* Operand. */
-        if (!token.is_operator)
+        if (!instruction.is_operator)
         {
-            operand_stack.push(evalToken(token, x));
+            assert(top < program.max_depth);
+
+            evalOperand(instruction, x, regs + top * n, n, precision, x_sorted);
+            top++;
         }
         /* Operator. */
         else
         {
-            std::vector<double> rhs = operand_stack.top();
-            operand_stack.pop();
+            assert(top >= 2);
+
+            evalOperator(instruction, regs + (top - 2) * n, regs + (top - 1) * n, n, precision);
+            top--;
+        }
+    }
+    assert(top == 1);
+
+    return regs;
+}
+
+const double* Decoder::evalProgram(const Program& program, const double* const* terms, size_t offset, size_t n, Precision precision)
+{
+    double* regs = registers(program.max_depth * n);
+
+    size_t top = 0;     /* The number of registers in use (the size of the operand stack). */
+    size_t term = 0;    /* The index of the next operand term. */
+    for (const auto& instruction : program.code)
+    {
+        /* Operand. */
+        if (!instruction.is_operator)
+        {
+            assert(top < program.max_depth);
 
-            std::vector<double> lhs = operand_stack.top();
-            operand_stack.pop();
+            std::copy(terms[term] + offset, terms[term] + offset + n, regs + top * n);
+            term++;
+            top++;
+        }
+        /* Operator. */
+        else
+        {
+            assert(top >= 2);
 
-            std::vector<double> result = performOperation(lhs, rhs, token.opid);
-            operand_stack.push(result);
+            evalOperator(instruction, regs + (top - 2) * n, regs + (top - 1) * n, n, precision);
+            top--;
         }
     }
-    assert(operand_stack.size() == 1);
+    assert(top == 1);
 
-    return operand_stack.top();
+    return regs;
 }
 
 /* Base functions. */
 
 /* Simple functions. */
 
-std::vector<double> Decoder::c(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::c(const double*, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = c */
 
-    std::vector<double> fx(x.size(), coeffs[2]);
-
-    return fx;
+    std::fill(fx, fx + n, coeffs[2]);
 }
 
-std::vector<double> Decoder::lin(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::lin(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*x + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * x[i] + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::poly(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::poly(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*x^n + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::pow(x[i], coeffs[4]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::rec(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::rec(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a/(b*x + c)^n + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] / std::pow(coeffs[1] * x[i] + coeffs[2], coeffs[4]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::root(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::root(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*(b*x + c)^(1/n) + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::pow(coeffs[1] * x[i] + coeffs[2], 1.0 / coeffs[4]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::exp(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::exp(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*e^(b*x + c) + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::exp(coeffs[1] * x[i] + coeffs[2]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::log(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::log(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*ln(b*x + c) + d,   x > -c/b */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::log(coeffs[1] * x[i] + coeffs[2]) + coeffs[3];
     }
-
-    return fx;
 }
 
 /* Other functions. */
 
-std::vector<double> Decoder::abs(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::abs(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*|x + c| + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::abs(x[i] + coeffs[2]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::sgn(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::sgn(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*sgn(x + c) + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         if (x[i] - coeffs[2] < 0)
         {
@@ -175,146 +233,300 @@ std::vector<double> Decoder::sgn(const std::vector<double>& x, const std::vector
             fx[i] = coeffs[0] + coeffs[3];
         }
     }
+}
+
+void Decoder::sgnSorted(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*sgn(x + c) + d, x - c < 0 exactly when x < c, so the points below, at, and above c are consecutive. */
+
+    if (std::isnan(coeffs[2])) return sgn(x, fx, n, coeffs);
 
-    return fx;
+    const double* zero_first = std::lower_bound(x, x + n, coeffs[2]);
+    const double* zero_last = std::upper_bound(zero_first, x + n, coeffs[2]);
+
+    std::fill(fx, fx + (zero_first - x), coeffs[3]);
+    std::fill(fx + (zero_first - x), fx + (zero_last - x), coeffs[0] / 2 + coeffs[3]);
+    std::fill(fx + (zero_last - x), fx + n, coeffs[0] + coeffs[3]);
 }
 
 /* Trigonometric functions. */
 
-std::vector<double> Decoder::cos(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::cos(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*cos(b*x + c) + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::cos(coeffs[1] * x[i] + coeffs[2]) + coeffs[3];
     }
-
-    return fx;
 }
 
 /* Inverse trigonometric functions. */
 
-std::vector<double> Decoder::arcsin(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::arcsin(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*arcsin(bx + c) + d,  -1 <= b*x+c <= 1 */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::asin(coeffs[1] * x[i] + coeffs[2]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::arctan(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::arctan(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*arctan(bx + c) + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::atan(coeffs[1] * x[i] + coeffs[2]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::arcsec(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::arcsec(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*arcsec(b*x + c) + d = a*acos(1/(b*x + c)) + d,  b*x + c >= 1.0, or <= -1.0 */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::acos(1.0 / (coeffs[1] * x[i] + coeffs[2])) + coeffs[3];
     }
-
-    return fx;
 }
 
 /* Inverse hyperbolic functions. */
 
-std::vector<double> Decoder::arsinh(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::arsinh(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*arsh(b*x + c) + d */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::asinh(coeffs[1] * x[i] + coeffs[2]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::arcosh(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::arcosh(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*arch(b*x + c) + d,   b*x + c >= 1.0 */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::acosh(coeffs[1] * x[i] + coeffs[2]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::artanh(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::artanh(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*arth(b*x + c) + d,   0 <= b*x+c <= 1 */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] * std::atanh(coeffs[1] * x[i] * coeffs[2]) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::arctgh(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::arctgh(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*arctgh(b*x + c) + d = a/2 * ln((b*x + c + 1)/(b*x + c - 1)) + d,   b*x + c < -1.0, or > 1.0 */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         fx[i] = coeffs[0] / 2.0 * std::log((coeffs[1] * x[i] + coeffs[2] + 1.0) / (coeffs[1] * x[i] + coeffs[2] - 1.0)) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::arsech(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::arsech(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*arsech(b*x + c) + d = a*ln((1 + sqrt(1 - (b*x+c)^2))/(b*x+c)) + d,   0 < b*x+c <= 1 */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         double xi = coeffs[1] * x[i] + coeffs[2];
         xi = (1.0 + std::sqrt(1.0 - xi * xi)) / xi;
         fx[i] = coeffs[0] * std::log(xi) + coeffs[3];
     }
-
-    return fx;
 }
 
-std::vector<double> Decoder::arcsch(const std::vector<double>& x, const std::vector<double>& coeffs)
+void Decoder::arcsch(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
 {
     /* f(x) = a*arcsch(b*x + c) + d = a*ln((1 + sqrt(1 - (b*x+c)^2))/(b*x+c)) + d,   b*x+c != 0 */
 
-    std::vector<double> fx(x.size());
-    for (size_t i = 0; i < x.size(); i++)
+    for (size_t i = 0; i < n; i++)
     {
         double xi = coeffs[1] * x[i] + coeffs[2];
         xi = (1.0 + std::sqrt(1.0 + xi * xi)) / xi;
         fx[i] = coeffs[0] * std::log(xi) + coeffs[3];
     }
+}
+
+/* Fast versions of the transcendental functions. */
+
+void Decoder::linearArg(const double* x, double* fx, size_t n, double b, double c)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        fx[i] = b * x[i] + c;
+    }
+}
+
+void Decoder::scaleResult(double* fx, size_t n, double a, double d)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        fx[i] = a * fx[i] + d;
+    }
+}
+
+void Decoder::polyFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*x^n + d */
+
+    fastPow(x, fx, n, coeffs[4]);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::recFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a/(b*x + c)^n + d */
 
-    return fx;
+    linearArg(x, fx, n, coeffs[1], coeffs[2]);
+    fastPow(fx, fx, n, coeffs[4]);
+    for (size_t i = 0; i < n; i++)
+    {
+        fx[i] = coeffs[0] / fx[i] + coeffs[3];
+    }
+}
+
+void Decoder::rootFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*(b*x + c)^(1/n) + d */
+
+    linearArg(x, fx, n, coeffs[1], coeffs[2]);
+    fastPow(fx, fx, n, 1.0 / coeffs[4]);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::expFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*e^(b*x + c) + d */
+
+    linearArg(x, fx, n, coeffs[1], coeffs[2]);
+    fastExp(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::logFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*ln(b*x + c) + d,   x > -c/b */
+
+    linearArg(x, fx, n, coeffs[1], coeffs[2]);
+    fastLog(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::cosFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*cos(b*x + c) + d */
+
+    linearArg(x, fx, n, coeffs[1], coeffs[2]);
+    fastCos(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::arcsinFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arcsin(bx + c) + d,  -1 <= b*x+c <= 1 */
+
+    linearArg(x, fx, n, coeffs[1], coeffs[2]);
+    fastAsin(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::arctanFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arctan(bx + c) + d */
+
+    linearArg(x, fx, n, coeffs[1], coeffs[2]);
+    fastAtan(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::arcsecFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arcsec(b*x + c) + d = a*acos(1/(b*x + c)) + d,  b*x + c >= 1.0, or <= -1.0 */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        fx[i] = 1.0 / (coeffs[1] * x[i] + coeffs[2]);
+    }
+    fastAcos(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::arsinhFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arsh(b*x + c) + d */
+
+    linearArg(x, fx, n, coeffs[1], coeffs[2]);
+    fastAsinh(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::arcoshFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arch(b*x + c) + d,   b*x + c >= 1.0 */
+
+    linearArg(x, fx, n, coeffs[1], coeffs[2]);
+    fastAcosh(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::artanhFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arth(b*x + c) + d,   0 <= b*x+c <= 1 */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        fx[i] = coeffs[1] * x[i] * coeffs[2];   /* Same argument as the exact version. */
+    }
+    fastAtanh(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::arctghFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arctgh(b*x + c) + d = a/2 * ln((b*x + c + 1)/(b*x + c - 1)) + d,   b*x + c < -1.0, or > 1.0 */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        fx[i] = (coeffs[1] * x[i] + coeffs[2] + 1.0) / (coeffs[1] * x[i] + coeffs[2] - 1.0);
+    }
+    fastLog(fx, fx, n);
+    scaleResult(fx, n, coeffs[0] / 2.0, coeffs[3]);
+}
+
+void Decoder::arsechFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arsech(b*x + c) + d = a*ln((1 + sqrt(1 - (b*x+c)^2))/(b*x+c)) + d,   0 < b*x+c <= 1 */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double xi = coeffs[1] * x[i] + coeffs[2];
+        fx[i] = (1.0 + std::sqrt(1.0 - xi * xi)) / xi;
+    }
+    fastLog(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
+}
+
+void Decoder::arcschFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arcsch(b*x + c) + d = a*ln((1 + sqrt(1 - (b*x+c)^2))/(b*x+c)) + d,   b*x+c != 0 */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double xi = coeffs[1] * x[i] + coeffs[2];
+        fx[i] = (1.0 + std::sqrt(1.0 + xi * xi)) / xi;
+    }
+    fastLog(fx, fx, n);
+    scaleResult(fx, n, coeffs[0], coeffs[3]);
 }
\ No newline at end of file
@@ -1,11 +1,11 @@
 /* Copyright (c) 2021 Krisztin Rugsi. */
 
-/* Decoder class for evaluating/parsing postfix expressions. Used in the fitness function to evaluate the function represented by the chromosomes. */
+/* Decoder class for evaluating compiled postfix programs. Used in the fitness function to evaluate the function represented by the chromosomes. */
 
 #ifndef DECODER_H
 #define DECODER_H
 
-#include "token.h"
+#include "program.h"
 
 #include <vector>
 #include <array>
@@ -13,16 +13,50 @@
 
 
 /*
-* Decode/evaluate a postfix expression.
-* The postfix expressions represent math functions where the operands are the base math functions, and the operators are simple math operators.
+* Decode/evaluate a compiled postfix program.
+* The programs represent math functions where the operands are the base math functions, and the operators are simple math operators.
 * These math function are evaluated for every point in a vector x.
 */
 class Decoder
 {
 public:
 
-    /* Evaluate the math function postfix_expr at every point in x. */
-    static std::vector<double> evalPostfixExpr(const std::vector<Token>& postfix_expr, const std::vector<double>& x);
+    /* The possible ways of evaluating the transcendental base functions. */
+    enum class Precision
+    {
+        exact,  /* Use the scalar functions of the standard library. */
+        fast    /* Use the vectorized approximations of vector_math.h (a few ulps of error). */
+    };
+
+    /* Evaluate the math function represented by program at every point in x. */
+    static std::vector<double> evalProgram(const Program& program, const std::vector<double>& x, Precision precision = Precision::exact);
+
+    /*
+    * Evaluate the math function represented by program at the n points starting at x, using scratch buffers owned by the calling thread.
+    * The buffers are only reallocated when they need to grow, and the returned results are only valid until the next evaluation on the same thread.
+    * If x_sorted is true, the points must be in ascending order, and the piecewise base functions are evaluated the same way as by evalOperand.
+    */
+    static const double* evalProgram(const Program& program, const double* x, size_t n, Precision precision = Precision::exact, bool x_sorted = false);
+
+    /*
+    * Evaluate the math function represented by program at the n points starting at offset, using the precomputed values of its operands:
+    * terms[k] contains the values of the k-th operand instruction of the program at every data point.
+    * The results are the same as if the operands were evaluated by the program with the same precision, and use the same buffers as the other overload.
+    */
+    static const double* evalProgram(const Program& program, const double* const* terms, size_t offset, size_t n, Precision precision = Precision::exact);
+
+    /*
+    * Evaluate an operand instruction (1 base math function) at the n points starting at x, writing the results to fx.
+    * If x_sorted is true, the points must be in ascending order, and the piecewise base functions are evaluated by finding their breakpoints
+    * with binary search, and filling the segments between them. The results are the same either way.
+    */
+    static void evalOperand(const Instruction& operand, const double* x, double* fx, size_t n, Precision precision = Precision::exact, bool x_sorted = false);
+
+    /*
+    * Evaluate an operator instruction on the n values starting at lhs and rhs, writing the results to lhs.
+    * With Precision::fast, the powers with the same exponent at every point are computed using fastPow from vector_math.h.
+    */
+    static void evalOperator(const Instruction& op, double* lhs, const double* rhs, size_t n, Precision precision = Precision::exact);
 
     /* The number of base math functions defined. */
     static constexpr size_t num_base_funcs() noexcept
@@ -32,47 +66,78 @@ public:
 
 private:
 
-    /* Evaluate an operand token (1 base math function) at every point in x. */
-    static std::vector<double> evalToken(const Token& token, const std::vector<double>& x);  
+    /* Returns the registers of the calling thread, with at least size elements. */
+    static double* registers(size_t size);
 
     /*
     * BASE MATH FUNCTIONS.
-    * Evaluate a base math function with coeffs coefficients at every point in the vector x.
+    * Evaluate a base math function with coeffs coefficients at the n points starting at x, writing the results to fx.
     */
 
     /* The type of the base math functions. */
-    using mathFunction_t = std::vector<double>(*)(const std::vector<double>& x, const std::vector<double>& coeffs);
+    using mathFunction_t = void(*)(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
 
     /* Simple functions. */
-    static std::vector<double> c(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> lin(const std::vector<double>& x, const std::vector<double>& coeffs);
+    static void c(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void lin(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
 
-    static std::vector<double> poly(const std::vector<double>& x, const std::vector<double>& coeffs);  //
-    static std::vector<double> rec(const std::vector<double>& x, const std::vector<double>& coeffs);   //
-    static std::vector<double> root(const std::vector<double>& x, const std::vector<double>& coeffs);  //
+    static void poly(const double* x, double* fx, size_t n, const coeffs_t& coeffs);  //
+    static void rec(const double* x, double* fx, size_t n, const coeffs_t& coeffs);   //
+    static void root(const double* x, double* fx, size_t n, const coeffs_t& coeffs);  //
 
-    static std::vector<double> exp(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> log(const std::vector<double>& x, const std::vector<double>& coeffs);
+    static void exp(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void log(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
 
     /* Other functions. */
-    static std::vector<double> abs(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> sgn(const std::vector<double>& x, const std::vector<double>& coeffs);
+    static void abs(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void sgn(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
 
     /* Trigonometric functions. */
-    static std::vector<double> cos(const std::vector<double>& x, const std::vector<double>& coeffs);
+    static void cos(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
 
     /* Inverse trigonometric functions. */
-    static std::vector<double> arcsin(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> arctan(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> arcsec(const std::vector<double>& x, const std::vector<double>& coeffs);
+    static void arcsin(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arctan(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arcsec(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
 
     /* Inverse hyperbolic functions. */
-    static std::vector<double> arsinh(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> arcosh(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> artanh(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> arctgh(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> arsech(const std::vector<double>& x, const std::vector<double>& coeffs);
-    static std::vector<double> arcsch(const std::vector<double>& x, const std::vector<double>& coeffs);
+    static void arsinh(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arcosh(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void artanh(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arctgh(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arsech(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arcsch(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+
+    /* Version of sgn for x values in ascending order, the points below and above the breakpoint are found with binary search. */
+    static void sgnSorted(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+
+    /*
+    * Fast versions of the transcendental base functions, using the approximations from vector_math.h.
+    * They compute the argument of the function for every point first, then the function over the whole array, and scale the results last.
+    * The powers use the multiplications and square roots of fastPow for the (half) integer exponents.
+    */
+
+    static void polyFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void recFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void rootFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void expFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void logFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void cosFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arcsinFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arctanFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arcsecFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arsinhFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arcoshFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void artanhFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arctghFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arsechFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+    static void arcschFast(const double* x, double* fx, size_t n, const coeffs_t& coeffs);
+
+    /* fx = b*x + c for the n points starting at x. */
+    static void linearArg(const double* x, double* fx, size_t n, double b, double c);
+
+    /* fx = a*fx + d for the n values starting at fx. */
+    static void scaleResult(double* fx, size_t n, double a, double d);
 
     /* Array of all the base functions. */
     static constexpr std::array<mathFunction_t, 19> base_functions =
@@ -81,6 +146,14 @@ private:
         arcsin, arctan, arcsec,
         arsinh, arcosh, artanh, arctgh, arsech, arcsch
     };
+
+    /* The base functions used with Precision::fast, in the same order. The functions without a fast version are the same as in base_functions. */
+    static constexpr std::array<mathFunction_t, 19> fast_base_functions =
+    {
+        c, lin, polyFast, recFast, rootFast, expFast, logFast, abs, sgn, cosFast,
+        arcsinFast, arctanFast, arcsecFast,
+        arsinhFast, arcoshFast, artanhFast, arctghFast, arsechFast, arcschFast
+    };
 };
 
 #endif // !DECODER_H
\ No newline at end of file
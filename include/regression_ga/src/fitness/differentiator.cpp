@@ -0,0 +1,363 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+#include "differentiator.h"
+#include "decoder.h"
+#include "program.h"
+#include "math_ops.h"
+
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
+#include <cstdlib>
+
+
+namespace
+{
+    /*
+    * The derivatives of the base functions and the operators are infinite or NaN at the boundaries of their domains (eg. arcsin at +-1, the roots at 0),
+    * even where the function itself is defined. They are set to 0 at these points, so they don't make the Jacobian undefined.
+    */
+    inline double finiteOrZero(double derivative) noexcept
+    {
+        return std::isfinite(derivative) ? derivative : 0.0;
+    }
+
+    /*
+    * The derivatives of a*g(b*x + c) + d at the n points starting at x, where dg is the derivative of g.
+    * The derivatives with respect to the exponent are 0 (the functions using it are handled separately).
+    */
+    template<typename G, typename DG>
+    inline void linearArgDerivatives(const double* x, double* dfx, size_t n, const coeffs_t& coeffs, G&& g, DG&& dg)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            double u = coeffs[1] * x[i] + coeffs[2];
+            double dfu = finiteOrZero(coeffs[0] * dg(u));
+
+            dfx[i] = g(u);
+            dfx[n + i] = dfu * x[i];
+            dfx[2 * n + i] = dfu;
+            dfx[3 * n + i] = 1.0;
+        }
+    }
+
+    /*
+    * Multiply the num_cols columns of n values starting at cols by the factors. The zero derivatives are left unchanged, so the
+    * points where the factor is not finite (eg. at the boundaries of the domain of pow) don't affect the coefficients that the value doesn't depend on.
+    * Where the factor is 0, the result doesn't depend on the operand at all, so its derivatives are 0 even if they are not finite (eg. NaN^0 = 1).
+    */
+    inline void scaleColumns(double* cols, size_t num_cols, size_t n, const double* factors)
+    {
+        for (size_t col = 0; col < num_cols; col++)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                double& d = cols[col * n + i];
+                d = (d == 0.0 || factors[i] == 0.0) ? 0.0 : d * factors[i];
+            }
+        }
+    }
+}
+
+
+void Differentiator::evalJacobian(const Program& program, const double* x, size_t n, double* fx, double* jacobian, Decoder::Precision precision)
+{
+    /* The values of the operand stack, and the index of the first operand of each subexpression on the stack. Reused between the calls on the same thread. */
+    thread_local std::vector<double> values;
+    thread_local std::vector<size_t> first_operand;
+
+    values.resize(std::max(values.size(), program.max_depth * n));
+    first_operand.resize(std::max(first_operand.size(), program.max_depth));
+
+    size_t top = 0;         /* The number of subexpressions on the stack. */
+    size_t operand = 0;     /* The index of the next operand. */
+    for (const auto& instruction : program.code)
+    {
+        /* Operand. */
+        if (!instruction.is_operator)
+        {
+            assert(top < program.max_depth);
+
+            Decoder::evalOperand(instruction, x, values.data() + top * n, n, precision);
+            evalOperandDerivatives(instruction, x, jacobian + operand * num_coeffs * n, n);
+
+            first_operand[top] = operand;
+            operand++;
+            top++;
+        }
+        /* Operator. */
+        else
+        {
+            assert(top >= 2);
+
+            double* lhs = values.data() + (top - 2) * n;
+            double* rhs = values.data() + (top - 1) * n;
+
+            size_t lhs_cols = (first_operand[top - 1] - first_operand[top - 2]) * num_coeffs;
+            size_t rhs_cols = (operand - first_operand[top - 1]) * num_coeffs;
+
+            propagate(lhs, rhs, n, instruction.opid,
+                      jacobian + first_operand[top - 2] * num_coeffs * n, lhs_cols,
+                      jacobian + first_operand[top - 1] * num_coeffs * n, rhs_cols);
+
+            Decoder::evalOperator(instruction, lhs, rhs, n, precision);
+            top--;
+        }
+    }
+    assert(top == 1);
+
+    std::copy(values.begin(), values.begin() + n, fx);
+}
+
+void Differentiator::evalOperandDerivatives(const Instruction& operand, const double* x, double* dfx, size_t n)
+{
+    assert(!operand.is_operator);
+    assert(size_t(operand.fid) < base_derivatives.size());
+
+    /* Most base functions don't use some of the coefficients. */
+    std::fill(dfx, dfx + num_coeffs * n, 0.0);
+
+    base_derivatives[operand.fid](x, dfx, n, operand.coeffs);
+}
+
+void Differentiator::propagate(const double* lhs, const double* rhs, size_t n, int op, double* dlhs, size_t num_lhs, double* drhs, size_t num_rhs)
+{
+    /* The derivatives of the result with respect to lhs and rhs at each point. Reused between the calls on the same thread. */
+    thread_local std::vector<double> dz_dlhs;
+    thread_local std::vector<double> dz_drhs;
+
+    dz_dlhs.resize(std::max(dz_dlhs.size(), n));
+    dz_drhs.resize(std::max(dz_drhs.size(), n));
+
+    switch (op)
+    {
+        case OP_ADD:
+            return;
+        case OP_SUB:
+            std::fill(dz_dlhs.begin(), dz_dlhs.begin() + n, 1.0);
+            std::fill(dz_drhs.begin(), dz_drhs.begin() + n, -1.0);
+            break;
+        case OP_MUL:
+            std::copy(rhs, rhs + n, dz_dlhs.begin());
+            std::copy(lhs, lhs + n, dz_drhs.begin());
+            break;
+        case OP_DIV:
+            for (size_t i = 0; i < n; i++)
+            {
+                dz_dlhs[i] = 1.0 / rhs[i];
+                dz_drhs[i] = -lhs[i] / (rhs[i] * rhs[i]);
+            }
+            break;
+        case OP_POW:
+            /* The derivative with respect to the exponent is only defined for positive bases (it is 0 for the integer exponents elsewhere). */
+            for (size_t i = 0; i < n; i++)
+            {
+                dz_dlhs[i] = finiteOrZero(rhs[i] * std::pow(lhs[i], rhs[i] - 1.0));
+                dz_drhs[i] = (lhs[i] > 0.0) ? finiteOrZero(std::pow(lhs[i], rhs[i]) * std::log(lhs[i])) : 0.0;
+            }
+            break;
+        default:
+            assert(false);	/* Invalid operator. Shouldn't get here. */
+            std::abort();
+    }
+
+    scaleColumns(dlhs, num_lhs, n, dz_dlhs.data());
+    scaleColumns(drhs, num_rhs, n, dz_drhs.data());
+}
+
+/* Simple functions. */
+
+void Differentiator::c(const double*, double* dfx, size_t n, const coeffs_t&)
+{
+    /* f(x) = c */
+
+    std::fill(dfx + 2 * n, dfx + 3 * n, 1.0);
+}
+
+void Differentiator::lin(const double* x, double* dfx, size_t n, const coeffs_t&)
+{
+    /* f(x) = a*x + d */
+
+    std::copy(x, x + n, dfx);
+    std::fill(dfx + 3 * n, dfx + 4 * n, 1.0);
+}
+
+void Differentiator::poly(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*x^n + d, the derivative with respect to n is only defined for x > 0 (it is 0 for the integer exponents elsewhere). */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double g = std::pow(x[i], coeffs[4]);
+
+        dfx[i] = g;
+        dfx[3 * n + i] = 1.0;
+        dfx[4 * n + i] = (x[i] > 0.0) ? coeffs[0] * g * std::log(x[i]) : 0.0;
+    }
+}
+
+void Differentiator::rec(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a/(b*x + c)^n + d */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double u = coeffs[1] * x[i] + coeffs[2];
+        double g = 1.0 / std::pow(u, coeffs[4]);
+        double dfu = finiteOrZero(-coeffs[0] * coeffs[4] * g / u);
+
+        dfx[i] = g;
+        dfx[n + i] = dfu * x[i];
+        dfx[2 * n + i] = dfu;
+        dfx[3 * n + i] = 1.0;
+        dfx[4 * n + i] = (u > 0.0) ? -coeffs[0] * g * std::log(u) : 0.0;
+    }
+}
+
+void Differentiator::root(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*(b*x + c)^(1/n) + d */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double u = coeffs[1] * x[i] + coeffs[2];
+        double g = std::pow(u, 1.0 / coeffs[4]);
+        double dfu = finiteOrZero(coeffs[0] * g / (coeffs[4] * u));
+
+        dfx[i] = g;
+        dfx[n + i] = dfu * x[i];
+        dfx[2 * n + i] = dfu;
+        dfx[3 * n + i] = 1.0;
+        dfx[4 * n + i] = (u > 0.0) ? -coeffs[0] * g * std::log(u) / (coeffs[4] * coeffs[4]) : 0.0;
+    }
+}
+
+void Differentiator::exp(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*e^(b*x + c) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::exp(u); }, [](double u) { return std::exp(u); });
+}
+
+void Differentiator::log(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*ln(b*x + c) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::log(u); }, [](double u) { return 1.0 / u; });
+}
+
+/* Other functions. */
+
+void Differentiator::abs(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*|x + c| + d */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double u = x[i] + coeffs[2];
+
+        dfx[i] = std::abs(u);
+        dfx[2 * n + i] = (u > 0.0) ? coeffs[0] : ((u < 0.0) ? -coeffs[0] : 0.0);
+        dfx[3 * n + i] = 1.0;
+    }
+}
+
+void Differentiator::sgn(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*sgn(x + c) + d, the derivative with respect to c is 0 almost everywhere. */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double u = x[i] - coeffs[2];
+
+        dfx[i] = (u < 0.0) ? 0.0 : ((u == 0.0) ? 0.5 : 1.0);
+        dfx[3 * n + i] = 1.0;
+    }
+}
+
+/* Trigonometric functions. */
+
+void Differentiator::cos(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*cos(b*x + c) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::cos(u); }, [](double u) { return -std::sin(u); });
+}
+
+/* Inverse trigonometric functions. */
+
+void Differentiator::arcsin(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arcsin(b*x + c) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::asin(u); }, [](double u) { return 1.0 / std::sqrt(1.0 - u * u); });
+}
+
+void Differentiator::arctan(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arctan(b*x + c) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::atan(u); }, [](double u) { return 1.0 / (1.0 + u * u); });
+}
+
+void Differentiator::arcsec(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arcsec(b*x + c) + d = a*arccos(1/(b*x + c)) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::acos(1.0 / u); }, [](double u) { return 1.0 / (u * u * std::sqrt(1.0 - 1.0 / (u * u))); });
+}
+
+/* Inverse hyperbolic functions. */
+
+void Differentiator::arsinh(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arsinh(b*x + c) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::asinh(u); }, [](double u) { return 1.0 / std::sqrt(u * u + 1.0); });
+}
+
+void Differentiator::arcosh(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arcosh(b*x + c) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::acosh(u); }, [](double u) { return 1.0 / std::sqrt(u * u - 1.0); });
+}
+
+void Differentiator::artanh(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*artanh(b*x*c) + d */
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double u = coeffs[1] * x[i] * coeffs[2];
+        double dfu = finiteOrZero(coeffs[0] / (1.0 - u * u));
+
+        dfx[i] = std::atanh(u);
+        dfx[n + i] = dfu * x[i] * coeffs[2];
+        dfx[2 * n + i] = dfu * coeffs[1] * x[i];
+        dfx[3 * n + i] = 1.0;
+    }
+}
+
+void Differentiator::arctgh(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arctgh(b*x + c) + d = a/2*ln((b*x + c + 1)/(b*x + c - 1)) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::log((u + 1.0) / (u - 1.0)) / 2.0; }, [](double u) { return 1.0 / (1.0 - u * u); });
+}
+
+void Differentiator::arsech(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arsech(b*x + c) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::log((1.0 + std::sqrt(1.0 - u * u)) / u); }, [](double u) { return -1.0 / (u * std::sqrt(1.0 - u * u)); });
+}
+
+void Differentiator::arcsch(const double* x, double* dfx, size_t n, const coeffs_t& coeffs)
+{
+    /* f(x) = a*arcsch(b*x + c) + d */
+
+    linearArgDerivatives(x, dfx, n, coeffs, [](double u) { return std::log((1.0 + std::sqrt(1.0 + u * u)) / u); }, [](double u) { return -1.0 / (u * std::sqrt(1.0 + u * u)); });
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/* Evaluation of the derivatives of the math functions represented by compiled programs with respect to the coefficients of their operands. */
+
+#ifndef DIFFERENTIATOR_H
+#define DIFFERENTIATOR_H
+
+#include "decoder.h"
+#include "program.h"
+#include "../genetic/gene.h"
+
+#include <array>
+#include <tuple>
+#include <cstddef>
+
+
+/*
+* Evaluates a program together with its exact partial derivatives with respect to the coefficients of its operands (base functions).
+* The derivatives are propagated forward through the operators along with the values (forward mode differentiation). Each operand only
+* depends on its own coefficients, and the operands of a subexpression are consecutive in the program, so the derivatives of a subexpression
+* are only nonzero for the coefficients of its own operands, and they are stored in the columns of the Jacobian belonging to these operands.
+*/
+class Differentiator
+{
+public:
+
+    /* The number of coefficients of each operand. */
+    static constexpr size_t num_coeffs = std::tuple_size_v<coeffs_t>;
+
+    /*
+    * Evaluate the math function represented by program at the n points starting at x, writing the results to fx, and its partial derivatives
+    * with respect to the coefficients of its operands to jacobian. The derivative with respect to the j-th coefficient of the k-th operand of the
+    * program (the k-th gene of the chromosome) at the i-th point is written to jacobian[(k*num_coeffs + j)*n + i].
+    * The values are calculated the same way as by the Decoder with the given precision.
+    */
+    static void evalJacobian(const Program& program, const double* x, size_t n, double* fx, double* jacobian, Decoder::Precision precision = Decoder::Precision::exact);
+
+    /*
+    * Evaluate the partial derivatives of an operand (1 base math function) with respect to its coefficients at the n points starting at x.
+    * The derivative with respect to the j-th coefficient at the i-th point is written to dfx[j*n + i].
+    */
+    static void evalOperandDerivatives(const Instruction& operand, const double* x, double* dfx, size_t n);
+
+private:
+
+    /*
+    * DERIVATIVES OF THE BASE MATH FUNCTIONS.
+    * Evaluate the partial derivatives of a base math function with coeffs coefficients with respect to each coefficient at the n points starting
+    * at x, writing the derivative with respect to the j-th coefficient at the i-th point to dfx[j*n + i]. They mirror the base functions of the
+    * Decoder, and only write the derivatives with respect to the coefficients used by the function, the others are left 0.
+    */
+
+    /* The type of the derivatives of the base math functions. */
+    using derivativeFunction_t = void(*)(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+
+    /* Simple functions. */
+    static void c(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void lin(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+
+    static void poly(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void rec(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void root(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+
+    static void exp(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void log(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+
+    /* Other functions. */
+    static void abs(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void sgn(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+
+    /* Trigonometric functions. */
+    static void cos(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+
+    /* Inverse trigonometric functions. */
+    static void arcsin(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void arctan(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void arcsec(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+
+    /* Inverse hyperbolic functions. */
+    static void arsinh(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void arcosh(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void artanh(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void arctgh(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void arsech(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+    static void arcsch(const double* x, double* dfx, size_t n, const coeffs_t& coeffs);
+
+    /* Array of the derivatives of all the base functions, in the same order as the base functions of the Decoder. */
+    static constexpr std::array<derivativeFunction_t, 19> base_derivatives =
+    {
+        c, lin, poly, rec, root, exp, log, abs, sgn, cos,
+        arcsin, arctan, arcsec,
+        arsinh, arcosh, artanh, arctgh, arsech, arcsch
+    };
+
+    /*
+    * Propagate the derivatives of the operands lhs and rhs of an operator to its result: the derivatives of lhs are the num_lhs columns
+    * starting at dlhs, and the derivatives of rhs are the num_rhs columns starting at drhs. Must be called before performing the operation.
+    */
+    static void propagate(const double* lhs, const double* rhs, size_t n, int op, double* dlhs, size_t num_lhs, double* drhs, size_t num_rhs);
+
+    static_assert(base_derivatives.size() == Decoder::num_base_funcs());
+};
+
+#endif // !DIFFERENTIATOR_H
\ No newline at end of file
@@ -0,0 +1,315 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+#include "domain_analysis.h"
+#include "program.h"
+#include "math_ops.h"
+#include "../genetic/gene.h"
+
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
+
+
+DomainAnalysis::Result DomainAnalysis::analyseOperand(const Instruction& operand, double x_min, double x_max)
+{
+    assert(!operand.is_operator);
+    assert(x_min <= x_max);
+
+    Result result;
+
+    /* The power functions are defined everywhere with integer exponents. */
+    if (isPowerFunction(operand.fid))
+    {
+        double n = exponent(operand.fid, operand.coeffs);
+        if (!std::isfinite(n) || std::trunc(n) == n) return result;
+    }
+
+    double magnitude_min, magnitude_max;
+    double u_min = argument(operand.fid, x_min, operand.coeffs, magnitude_min);
+    double u_max = argument(operand.fid, x_max, operand.coeffs, magnitude_max);
+
+    int part_min = undefinedPart(operand.fid, u_min, magnitude_min);
+    int part_max = undefinedPart(operand.fid, u_max, magnitude_max);
+
+    result.at_min = (part_min != 0);
+    result.at_max = (part_max != 0);
+    result.everywhere = (part_min != 0 && part_min == part_max);
+
+    return result;
+}
+
+DomainAnalysis::Result DomainAnalysis::analyseProgram(const Program& program, double x_min, double x_max)
+{
+    /* The results of the operands on the stack. Reused by every analysis on the same thread. */
+    thread_local std::vector<Result> stack;
+    stack.clear();
+
+    for (const auto& instruction : program.code)
+    {
+        /* Operand. */
+        if (!instruction.is_operator)
+        {
+            stack.push_back(analyseOperand(instruction, x_min, x_max));
+        }
+        /* Operator. */
+        else
+        {
+            assert(stack.size() >= 2);
+
+            Result rhs = stack.back();
+            stack.pop_back();
+            Result& lhs = stack.back();
+
+            if (instruction.opid == OP_POW)
+            {
+                lhs = Result{};
+            }
+            else
+            {
+                lhs.at_min = lhs.at_min || rhs.at_min;
+                lhs.at_max = lhs.at_max || rhs.at_max;
+                lhs.everywhere = lhs.everywhere || rhs.everywhere;
+            }
+        }
+    }
+    assert(stack.size() == 1);
+
+    return stack.back();
+}
+
+bool DomainAnalysis::isUndefined(int fid, const limits_t& limits, double x_min, double x_max)
+{
+    assert(limits.size() == std::tuple_size_v<coeffs_t>);
+    assert(x_min <= x_max);
+
+    Interval x{ x_min, x_max };
+    Interval b{ limits[1].first, limits[1].second };
+    Interval c{ limits[2].first, limits[2].second };
+    Interval n{ limits[4].first, limits[4].second };
+
+    /* The power functions are defined everywhere if any integer exponent can be used. */
+    if (isPowerFunction(fid))
+    {
+        /* root uses 1/n as the exponent, which is unbounded if the interval contains 0. */
+        if (fid == 4)
+        {
+            if (n.lo <= 0.0 && n.hi >= 0.0) return false;
+            n = { 1.0 / n.hi, 1.0 / n.lo };
+        }
+        if (std::floor(n.hi) >= n.lo) return false;
+    }
+
+    /* The range of the argument of the function. */
+    Interval u;
+    switch (fid)
+    {
+        case 2:     /* poly */
+            u = x;
+            break;
+        case 15:    /* artanh */
+            u = mul(mul(b, x), c);
+            break;
+        default:
+            u = add(mul(b, x), c);
+    }
+
+    double magnitude = std::max({ std::abs(u.lo), std::abs(u.hi), 1.0 });
+    int part_lo = undefinedPart(fid, u.lo, magnitude);
+    int part_hi = undefinedPart(fid, u.hi, magnitude);
+
+    return part_lo != 0 && part_lo == part_hi;
+}
+
+bool DomainAnalysis::isDefined(int fid, const coeffs_t& coeffs, double x_min, double x_max)
+{
+    assert(x_min <= x_max);
+
+    /* The power functions are defined everywhere with integer exponents. */
+    if (isPowerFunction(fid))
+    {
+        double n = exponent(fid, coeffs);
+        if (!std::isfinite(n) || std::trunc(n) == n) return true;
+    }
+
+    /* The argument is monotonic in x, so it is inside a connected part of the domain at every point if it is inside the same part at both ends. */
+    double magnitude;
+    double u_min = argument(fid, x_min, coeffs, magnitude);
+    double u_max = argument(fid, x_max, coeffs, magnitude);
+
+    for (const auto& part : domainParts(fid))
+    {
+        if (part.lo <= std::min(u_min, u_max) && std::max(u_min, u_max) <= part.hi) return true;
+    }
+
+    return false;
+}
+
+std::vector<std::pair<double, double>> DomainAnalysis::definedOffsets(int fid, double b, std::pair<double, double> c_bounds, double x_min, double x_max)
+{
+    assert(c_bounds.first <= c_bounds.second);
+    assert(x_min <= x_max);
+
+    std::vector<std::pair<double, double>> offsets;
+
+    /* The range of b*x in the interval. */
+    Interval bx{ std::min(b * x_min, b * x_max), std::max(b * x_min, b * x_max) };
+
+    for (const auto& part : domainParts(fid))
+    {
+        Interval c;
+        switch (fid)
+        {
+            case 2:     /* poly: the argument doesn't depend on c. */
+                if (x_min < part.lo || part.hi < x_max) continue;
+                c = { c_bounds.first, c_bounds.second };
+                break;
+            case 15:    /* artanh: c*b*x must be in [-1, 1]. */
+            {
+                double bx_max = std::max(std::abs(bx.lo), std::abs(bx.hi));
+                c = (bx_max == 0.0) ? Interval{ c_bounds.first, c_bounds.second } : Interval{ -1.0 / bx_max, 1.0 / bx_max };
+                break;
+            }
+            default:    /* b*x + c must be in the part for every x. */
+                c = { part.lo - bx.lo, part.hi - bx.hi };
+        }
+
+        c.lo = std::max(c.lo, c_bounds.first);
+        c.hi = std::min(c.hi, c_bounds.second);
+
+        if (c.lo <= c.hi) offsets.emplace_back(c.lo, c.hi);
+    }
+
+    return offsets;
+}
+
+std::pair<double, double> DomainAnalysis::definedSlopes(int fid, std::pair<double, double> b_bounds, double x_min, double x_max)
+{
+    assert(b_bounds.first <= b_bounds.second);
+    assert(x_min <= x_max);
+
+    /* The argument of poly doesn't depend on b, and the argument of artanh can be scaled into its domain by c. */
+    if (fid == 2 || fid == 15 || x_min == x_max) return b_bounds;
+
+    /* b*x + c changes by |b|*(x_max - x_min) over the interval, which must fit in one of the parts of the domain. */
+    double max_width = 0.0;
+    for (const auto& part : domainParts(fid))
+    {
+        max_width = std::max(max_width, part.hi - part.lo);
+    }
+    double max_slope = max_width / (x_max - x_min);
+
+    return { std::max(b_bounds.first, -max_slope), std::min(b_bounds.second, max_slope) };
+}
+
+bool DomainAnalysis::isPowerFunction(int fid) noexcept
+{
+    /* poly, rec, root */
+    return fid == 2 || fid == 3 || fid == 4;
+}
+
+double DomainAnalysis::exponent(int fid, const coeffs_t& coeffs) noexcept
+{
+    assert(isPowerFunction(fid));
+
+    return (fid == 4) ? 1.0 / coeffs[4] : coeffs[4];
+}
+
+double DomainAnalysis::argument(int fid, double x, const coeffs_t& coeffs, double& magnitude) noexcept
+{
+    /* The arguments are calculated the same way as in the Decoder. */
+    switch (fid)
+    {
+        case 2:     /* poly */
+            magnitude = std::abs(x);
+            return x;
+        case 15:    /* artanh */
+            magnitude = std::abs(coeffs[1] * x * coeffs[2]);
+            return coeffs[1] * x * coeffs[2];
+        default:
+            magnitude = std::abs(coeffs[1] * x) + std::abs(coeffs[2]);
+            return coeffs[1] * x + coeffs[2];
+    }
+}
+
+int DomainAnalysis::undefinedPart(int fid, double u, double magnitude) noexcept
+{
+    if (!std::isfinite(u) || !std::isfinite(magnitude)) return 0;
+
+    /*
+    * The arguments calculated here might differ slightly from the ones calculated by the Decoder (eg. if it uses fma instructions),
+    * so the values closer to the boundaries of the domains than the possible rounding errors are considered to be defined.
+    */
+    const double margin = 1E-9 * std::max(magnitude, 1.0);
+
+    switch (fid)
+    {
+        case 2:     /* poly:   u >= 0 (non-integer exponent) */
+        case 3:     /* rec:    u >= 0 (non-integer exponent) */
+        case 4:     /* root:   u >= 0 (non-integer exponent) */
+        case 6:     /* log:    u >= 0 */
+        case 18:    /* arcsch: u >= 0 */
+            return (u < -margin) ? 1 : 0;
+        case 10:    /* arcsin: -1 <= u <= 1 */
+        case 15:    /* artanh: -1 <= u <= 1 */
+            if (u < -1.0 - margin) return 1;
+            if (u > 1.0 + margin) return 2;
+            return 0;
+        case 12:    /* arcsec: u <= -1 or u >= 1 */
+        case 16:    /* arctgh: u <= -1 or u >= 1 */
+            return (-1.0 + margin < u && u < 1.0 - margin) ? 1 : 0;
+        case 14:    /* arcosh: u >= 1 */
+            return (u < 1.0 - margin) ? 1 : 0;
+        case 17:    /* arsech: 0 <= u <= 1 */
+            if (u < -margin) return 1;
+            if (u > 1.0 + margin) return 2;
+            return 0;
+        default:    /* Defined everywhere. */
+            return 0;
+    }
+}
+
+std::vector<DomainAnalysis::Interval> DomainAnalysis::domainParts(int fid)
+{
+    constexpr double inf = std::numeric_limits<double>::infinity();
+
+    switch (fid)
+    {
+        case 2:     /* poly */
+        case 3:     /* rec */
+        case 4:     /* root */
+        case 6:     /* log */
+        case 18:    /* arcsch */
+            return { { 0.0, inf } };
+        case 10:    /* arcsin */
+        case 15:    /* artanh */
+            return { { -1.0, 1.0 } };
+        case 12:    /* arcsec */
+        case 16:    /* arctgh */
+            return { { -inf, -1.0 }, { 1.0, inf } };
+        case 14:    /* arcosh */
+            return { { 1.0, inf } };
+        case 17:    /* arsech */
+            return { { 0.0, 1.0 } };
+        default:    /* Defined everywhere. */
+            return { { -inf, inf } };
+    }
+}
+
+DomainAnalysis::Interval DomainAnalysis::add(Interval lhs, Interval rhs) noexcept
+{
+    return { lhs.lo + rhs.lo, lhs.hi + rhs.hi };
+}
+
+DomainAnalysis::Interval DomainAnalysis::mul(Interval lhs, Interval rhs) noexcept
+{
+    double p1 = lhs.lo * rhs.lo;
+    double p2 = lhs.lo * rhs.hi;
+    double p3 = lhs.hi * rhs.lo;
+    double p4 = lhs.hi * rhs.hi;
+
+    return { std::min({ p1, p2, p3, p4 }), std::max({ p1, p2, p3, p4 }) };
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/*
+* Static analysis of the domains of the base functions. Used to find the chromosomes whose functions are undefined (NaN)
+* at some of the data points without evaluating them, and the base functions that can't be defined for any coefficients.
+*/
+
+#ifndef DOMAIN_ANALYSIS_H
+#define DOMAIN_ANALYSIS_H
+
+#include "program.h"
+#include "../genetic/gene.h"
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+
+/*
+* Find where the functions represented by the programs are certainly undefined in an interval of x.
+* The arguments of the base functions are monotonic in x, so their ranges over the interval are determined by their values at the
+* ends of the interval, and a base function is undefined at every point of the interval if both ends fall in the same connected part of the
+* undefined region of the function. The undefined values are propagated through every operator except pow, as pow(x, 0) and pow(1, y)
+* are defined even for undefined x and y.
+* The analysis is conservative: the values close to the boundaries of the domains are considered to be defined.
+*/
+class DomainAnalysis
+{
+public:
+
+    /* The lower and upper bounds of each coefficient of the genes. */
+    using limits_t = std::vector<std::pair<double, double>>;
+
+    /* The result of the analysis of a function in the interval [x_min, x_max]. */
+    struct Result
+    {
+        bool at_min = false;        /* The function is undefined at x_min. */
+        bool at_max = false;        /* The function is undefined at x_max. */
+        bool everywhere = false;    /* The function is undefined at every point in [x_min, x_max]. */
+    };
+
+    /* Analyse an operand instruction (1 base math function) in [x_min, x_max]. */
+    static Result analyseOperand(const Instruction& operand, double x_min, double x_max);
+
+    /* Analyse the math function represented by program in [x_min, x_max]. */
+    static Result analyseProgram(const Program& program, double x_min, double x_max);
+
+    /*
+    * Returns true if the base function fid is undefined at every point in [x_min, x_max] for any coefficients within limits.
+    * The limits are the bounds of the coefficients in the order they are stored in the genes.
+    */
+    static bool isUndefined(int fid, const limits_t& limits, double x_min, double x_max);
+
+    /* Returns true if the base function fid with the coefficients coeffs is defined at every point in [x_min, x_max]. */
+    static bool isDefined(int fid, const coeffs_t& coeffs, double x_min, double x_max);
+
+    /*
+    * Returns the intervals of the values of the coefficient c within c_bounds for which the base function fid with the coefficient b
+    * is defined at every point in [x_min, x_max], assuming non-integer exponents for the power functions. Returns an empty vector if there are none.
+    */
+    static std::vector<std::pair<double, double>> definedOffsets(int fid, double b, std::pair<double, double> c_bounds, double x_min, double x_max);
+
+    /*
+    * Returns the interval of the values of the coefficient b within b_bounds for which the base function fid can be defined at every point in
+    * [x_min, x_max] with some value of c (regardless of its bounds). The returned lower bound is greater than the upper bound if there are none.
+    */
+    static std::pair<double, double> definedSlopes(int fid, std::pair<double, double> b_bounds, double x_min, double x_max);
+
+private:
+
+    /* The closed interval [lo, hi]. */
+    struct Interval
+    {
+        double lo;
+        double hi;
+    };
+
+    /* Returns true if the base function fid is calculated as a power of its argument. */
+    static bool isPowerFunction(int fid) noexcept;
+
+    /* The exponent used by the power functions. */
+    static double exponent(int fid, const coeffs_t& coeffs) noexcept;
+
+    /* The argument of the base function fid at x, and the magnitude of the terms used to calculate it. */
+    static double argument(int fid, double x, const coeffs_t& coeffs, double& magnitude) noexcept;
+
+    /*
+    * Returns 0 if the base function fid is defined for the argument u (or if u is too close to the boundary of its domain), otherwise
+    * the index of the connected part of the undefined region containing u. The power functions are assumed to have non-integer exponents.
+    */
+    static int undefinedPart(int fid, double u, double magnitude) noexcept;
+
+    /* The connected parts of the domain of the base function fid (the allowed values of its argument), assuming non-integer exponents for the power functions. */
+    static std::vector<Interval> domainParts(int fid);
+
+    /* Interval arithmetic. */
+    static Interval add(Interval lhs, Interval rhs) noexcept;
+    static Interval mul(Interval lhs, Interval rhs) noexcept;
+};
+
+#endif // !DOMAIN_ANALYSIS_H
\ No newline at end of file
@@ -1,37 +1,92 @@
 /* Copyright (c) 2021 Krisztin Rugsi. */
 
 #include "fitness_function.h"
+#include "dataset.h"
 #include "converter.h"
 #include "decoder.h"
-#include "token.h"
+#include "program.h"
+#include "term_cache.h"
+#include "term_records.h"
+#include "domain_analysis.h"
+#include "least_squares.h"
+#include "differentiator.h"
+#include "simplifier.h"
+#include "math_ops.h"
 #include "../genetic/gene.h"
 
 #include <algorithm>
+#include <numeric>
 #include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <utility>
 #include <limits>
 #include <cmath>
 #include <cstddef>
 #include <cassert>
 #include <cstdlib>
 
+namespace
+{
+    /* Neumaier's compensated summation, the error of the sum is at most 2*eps*|sum| + O(n*eps^2)*sum(|x_i|) instead of O(n*eps)*sum(|x_i|). */
+    class CompensatedSum
+    {
+    public:
+        void add(double x) noexcept
+        {
+            double sum = sum_ + x;
+            compensation_ += (std::abs(sum_) >= std::abs(x)) ? (sum_ - sum) + x : (x - sum) + sum_;
+            sum_ = sum;
+        }
+
+        double value() const noexcept { return sum_ + compensation_; }
+
+    private:
+        double sum_ = 0.0;
+        double compensation_ = 0.0;
+    };
+}
+
 /* Constructors. */
 
 FitnessFunction::FitnessFunction(const std::vector<double>& x, const std::vector<double>& fx_desired, Objective error_metric) :
-	x_(x),
-	fx_desired_(fx_desired),
+	FitnessFunction(std::make_shared<const Dataset>(x, fx_desired), error_metric)
+{
+}
+
+FitnessFunction::FitnessFunction(std::shared_ptr<const Dataset> data, Objective error_metric) :
 	error_metric_(error_metric)
 {
-	assert(x.size() == fx_desired.size());
+	this->data(std::move(data));
 }
 
 /* Setters. */
 
 void FitnessFunction::data(const std::vector<double>& x, const std::vector<double>& fx_desired)
 {
-	assert(x.size() == fx_desired.size());
+	data(std::make_shared<const Dataset>(x, fx_desired));
+}
+
+void FitnessFunction::data(std::shared_ptr<const Dataset> data)
+{
+	assert(data != nullptr && data->size() > 0);
 
-	x_ = x;
-	fx_desired_ = fx_desired;
+	data_ = std::move(data);
+	x_ = data_->x();
+	fx_desired_ = data_->fx_desired();
+	weights_ = data_->weights();
+	num_points_ = data_->size();
+	total_weight_ = weights_ ? std::accumulate(weights_, weights_ + num_points_, 0.0) : double(num_points_);
+	term_cache_->clear();
+	term_records_->clear();
+	{
+		std::lock_guard<std::mutex> guard(samples_->lock);
+		samples_->samples.clear();
+	}
+
+	updateRange();
+	updateMoments();
 }
 
 void FitnessFunction::error_metric(Objective error_metric)
@@ -39,98 +94,1287 @@ void FitnessFunction::error_metric(Objective error_metric)
     error_metric_ = error_metric;
 }
 
+void FitnessFunction::precision(Decoder::Precision precision)
+{
+    precision_ = precision;
+    term_cache_->clear();
+    term_records_->clear();
+}
+
+void FitnessFunction::term_cache_memory(size_t max_bytes)
+{
+    term_cache_->max_bytes(max_bytes);
+}
+
+void FitnessFunction::term_records_memory(size_t max_bytes)
+{
+    term_records_->max_bytes(max_bytes);
+}
+
+/* Getters. */
+
+const TermCache& FitnessFunction::term_cache() const noexcept
+{
+    return *term_cache_;
+}
+
+const TermRecords& FitnessFunction::term_records() const noexcept
+{
+    return *term_records_;
+}
+
+double FitnessFunction::x_min() const noexcept
+{
+    return x_min_;
+}
+
+double FitnessFunction::x_max() const noexcept
+{
+    return x_max_;
+}
+
+size_t FitnessFunction::num_rejected() const noexcept
+{
+    return nan_counters_->rejected;
+}
+
+std::vector<size_t> FitnessFunction::rejected_funcs() const
+{
+    return std::vector<size_t>(nan_counters_->rejected_funcs.begin(), nan_counters_->rejected_funcs.end());
+}
+
+size_t FitnessFunction::num_undefined() const noexcept
+{
+    return nan_counters_->undefined;
+}
+
 /* Fitness function call. */
 std::vector<double> FitnessFunction::operator()(const std::vector<Gene>& chrom) const
 {
-	std::vector<Token> infix_expr = Converter::chromosomeToInfix(chrom);
-    std::vector<Token> postfix_expr = Converter::infixToPostfix(infix_expr);
+    return (*this)(chrom, -std::numeric_limits<double>::infinity());
+}
 
-    std::vector<double> fx_actual = Decoder::evalPostfixExpr(postfix_expr, x_);
+std::vector<double> FitnessFunction::operator()(const std::vector<Gene>& chrom, double threshold) const
+{
+    /* The simplified chromosome, the compiled program and the evaluation buffers are reused between the calls on the same thread. */
+    thread_local std::vector<Gene> simplified;
+    Simplifier::simplify(chrom, simplified, precision_);
 
-	double error;
-	switch (error_metric_)
-	{
-		case Objective::LS:
-			error = squareErrorMean(fx_actual, fx_desired_);
-			break;
-		case Objective::LAD:
-			error = absoluteErrorMean(fx_actual, fx_desired_);
-			break;
-		case Objective::RMSE:
-			error = rootMeanSquareError(fx_actual, fx_desired_);
-			break;
-		case Objective::MINMAX:
-			error = maximumError(fx_actual, fx_desired_);
-			break;
-		default:
-			assert(false);	/* Invalid objective, shouldn't get here. */
-			std::abort();
-	}
+    /* Polynomials don't have to be evaluated at the data points. */
+    double moment_error;
+    if (momentSquareError(simplified, moment_error)) return { errorToFitness(moment_error) };
+
+    thread_local Program program;
+    Converter::chromosomeToProgram(simplified, program);
+
+    /* The error of undefined functions is NaN. With MINMAX, it is only NaN if the function is undefined at the first point. */
+    if (isUndefined(program, error_metric_ == Objective::MINMAX)) return { 0.0 };
+
+    /*
+    * The values of the operands of the program are taken from the term cache if it is enabled.
+    * The missing terms are evaluated block by block with the program, and only added to the cache if every block was evaluated.
+    */
+    thread_local std::vector<TermCache::term_t> terms;
+    thread_local std::vector<const double*> term_values;
+    thread_local std::vector<NewTerm> new_terms;
+
+    const bool use_term_cache = term_cache_->enabled();
+    if (use_term_cache) lookupTerms(program, terms, term_values, new_terms);
+
+    /*
+    * The function is evaluated over consecutive blocks of the data points, and the error metric is accumulated
+    * block by block, so the evaluation buffers stay small enough to remain in the cache regardless of the number of points.
+    */
+    const size_t num_points = num_points_;
+
+    double error = 0.0;
+    bool complete = true;
+    for (size_t first = 0; first < num_points; first += block_size)
+    {
+        size_t len = std::min(block_size, num_points - first);
+
+        if (use_term_cache) evalNewTerms(new_terms, first, len);
+
+        const double* fx_actual = use_term_cache ?
+            Decoder::evalProgram(program, term_values.data(), first, len, precision_) :
+            Decoder::evalProgram(program, x_ + first, len, precision_, x_sorted_);
+
+        error = accumulateError(fx_actual, fx_desired_ + first, weights_ ? weights_ + first : nullptr, len, total_weight_, first == 0, error);
 
-    double fitness = std::isnan(error) ? 0.0 : 1.0 / error;
+        /* The error can only grow with the remaining points, so the fitness can't reach the threshold anymore. */
+        if (errorToFitness(error) < threshold && first + len < num_points)
+        {
+            complete = false;
+            break;
+        }
+    }
+
+    /* The values of the new terms are incomplete after stopping early, so they can't be added to the cache. */
+    if (complete) storeNewTerms(new_terms);
+    new_terms.clear();
+
+    /* Don't keep the terms alive after they are evicted from the cache. */
+    terms.clear();
 
-    return { fitness };
+    if (std::isnan(error)) nan_counters_->undefined++;
+
+    return { errorToFitness(error) };
 }
 
-/* Objective functions. */
+std::vector<double> FitnessFunction::operator()(const std::vector<Gene>& chrom, const std::vector<Gene>& parent, double threshold) const
+{
+    if (!term_records_->enabled()) return (*this)(chrom, threshold);
+
+    thread_local std::vector<Gene> simplified;
+    Simplifier::simplify(chrom, simplified, precision_);
+
+    double moment_error;
+    if (momentSquareError(simplified, moment_error)) return { errorToFitness(moment_error) };
+
+    thread_local Program program;
+    Converter::chromosomeToProgram(simplified, program);
+
+    if (isUndefined(program, error_metric_ == Objective::MINMAX)) return { 0.0 };
+
+    TermRecords::record_t parent_record = parent.empty() ? nullptr : term_records_->find(parent);
+
+    /*
+    * Take the values of the base function terms of the program that are also in the record of the parent from the record,
+    * and allocate the values of the other terms, which are evaluated over the blocks of the data points below.
+    * The buffers are reused between the calls on the same thread.
+    */
+    auto record = std::make_shared<TermRecords::Record>();
+    record->num_points = num_points_;
 
-double FitnessFunction::squareErrorMean(const std::vector<double>& fx_actual, const std::vector<double>& fx_desired)
+    thread_local std::vector<const Instruction*> new_operands;
+    thread_local std::vector<double*> new_values;
+    thread_local std::vector<const double*> term_values;
+
+    new_operands.clear();
+    new_values.clear();
+    term_values.clear();
+
+    for (const auto& instruction : program.code)
+    {
+        if (instruction.is_operator) continue;
+
+        TermRecords::Term term{ instruction.fid, instruction.coeffs, nullptr };
+        if (parent_record)
+        {
+            auto same = std::find_if(parent_record->terms.begin(), parent_record->terms.end(), [&instruction](const TermRecords::Term& parent_term)
+            {
+                return parent_term.same(instruction.fid, instruction.coeffs);
+            });
+            if (same != parent_record->terms.end()) term.values = same->values;
+        }
+        if (!term.values)
+        {
+            /* The values are written by the evaluation, so they don't have to be initialized. */
+            auto values = std::make_shared_for_overwrite<double[]>(num_points_);
+            new_operands.push_back(&instruction);
+            new_values.push_back(values.get());
+            term.values = std::move(values);
+        }
+        term_values.push_back(term.values.get());
+        record->terms.push_back(std::move(term));
+    }
+
+    /* The new terms and the program are evaluated over the same blocks of the data points as in the other overloads, so the results are the same. */
+    const size_t num_points = num_points_;
+
+    double error = 0.0;
+    bool complete = true;
+    for (size_t first = 0; first < num_points; first += block_size)
+    {
+        size_t len = std::min(block_size, num_points - first);
+
+        for (size_t k = 0; k < new_operands.size(); k++)
+        {
+            Decoder::evalOperand(*new_operands[k], x_ + first, new_values[k] + first, len, precision_, x_sorted_);
+        }
+        const double* fx_actual = Decoder::evalProgram(program, term_values.data(), first, len, precision_);
+
+        error = accumulateError(fx_actual, fx_desired_ + first, weights_ ? weights_ + first : nullptr, len, total_weight_, first == 0, error);
+
+        /* The values of the new terms are incomplete, so the record can't be used after stopping early. */
+        if (errorToFitness(error) < threshold && first + len < num_points)
+        {
+            complete = false;
+            break;
+        }
+    }
+
+    if (complete) term_records_->insert(chrom, std::move(record));
+    if (std::isnan(error)) nan_counters_->undefined++;
+
+    return { errorToFitness(error) };
+}
+
+std::vector<std::vector<double>> FitnessFunction::operator()(const std::vector<std::vector<Gene>>& chroms) const
 {
-    assert(fx_actual.size() == fx_desired.size());
+    const size_t batch_size = chroms.size();
+
+    /* The simplified chromosomes, the programs and the terms of the chromosomes are reused between the calls on the same thread. */
+    thread_local std::vector<Gene> simplified;
+    thread_local std::vector<Program> programs;
+    thread_local std::vector<std::vector<TermCache::term_t>> terms;
+    thread_local std::vector<std::vector<const double*>> term_values;
+    thread_local std::vector<std::vector<NewTerm>> new_terms;
 
-    double mean = 0.0;
-    for (size_t i = 0; i < fx_actual.size(); i++)
+    if (programs.size() < batch_size)
     {
-        double error_sq = (fx_actual[i] - fx_desired[i]) * (fx_actual[i] - fx_desired[i]);
-        error_sq = std::min(error_sq, std::numeric_limits<double>::max());
+        programs.resize(batch_size);
+        terms.resize(batch_size);
+        term_values.resize(batch_size);
+        new_terms.resize(batch_size);
+    }
+
+    /* The undefined programs are not evaluated, their error is NaN. The polynomials are not evaluated either, their error is calculated from the moments. */
+    std::vector<char> undefined(batch_size);
+    std::vector<char> polynomial(batch_size);
+    std::vector<double> errors(batch_size, 0.0);
+
+    const bool use_term_cache = term_cache_->enabled();
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        Simplifier::simplify(chroms[i], simplified, precision_);
+
+        polynomial[i] = momentSquareError(simplified, errors[i]);
+        if (polynomial[i]) continue;
 
-        mean += error_sq / double(fx_actual.size());
+        Converter::chromosomeToProgram(simplified, programs[i]);
+
+        undefined[i] = isUndefined(programs[i], error_metric_ == Objective::MINMAX);
+        if (undefined[i]) errors[i] = std::numeric_limits<double>::quiet_NaN();
+
+        if (use_term_cache && !undefined[i]) lookupTerms(programs[i], terms[i], term_values[i], new_terms[i]);
     }
 
-    return mean;
+    /* Evaluate every program on the same block of the data points before moving to the next block. */
+    const size_t num_points = num_points_;
+
+    for (size_t first = 0; first < num_points; first += block_size)
+    {
+        size_t len = std::min(block_size, num_points - first);
+
+        for (size_t i = 0; i < batch_size; i++)
+        {
+            if (undefined[i] || polynomial[i]) continue;
+
+            if (use_term_cache) evalNewTerms(new_terms[i], first, len);
+
+            const double* fx_actual = use_term_cache ?
+                Decoder::evalProgram(programs[i], term_values[i].data(), first, len, precision_) :
+                Decoder::evalProgram(programs[i], x_ + first, len, precision_, x_sorted_);
+
+            errors[i] = accumulateError(fx_actual, fx_desired_ + first, weights_ ? weights_ + first : nullptr, len, total_weight_, first == 0, errors[i]);
+        }
+    }
+
+    std::vector<std::vector<double>> fitness;
+    fitness.reserve(batch_size);
+
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        storeNewTerms(new_terms[i]);
+        terms[i].clear();
+        if (!undefined[i] && std::isnan(errors[i])) nan_counters_->undefined++;
+
+        fitness.push_back({ errorToFitness(errors[i]) });
+    }
+
+    return fitness;
 }
 
-double FitnessFunction::absoluteErrorMean(const std::vector<double>& fx_actual, const std::vector<double>& fx_desired)
+std::vector<double> FitnessFunction::evaluateSample(const std::vector<Gene>& chrom, double fraction) const
 {
-    assert(fx_actual.size() == fx_desired.size());
+    assert(0.0 < fraction && fraction <= 1.0);
+
+    const size_t num_points = num_points_;
+    const size_t sample_size = std::clamp(size_t(std::ceil(fraction * double(num_points))), std::min(min_sample_size, num_points), num_points);
+
+    thread_local std::vector<Gene> simplified;
+    Simplifier::simplify(chrom, simplified, precision_);
 
-    double mean = 0.0;
-    for (size_t i = 0; i < fx_actual.size(); i++)
+    /* The error of the polynomials is calculated over every point from the moments, which is cheaper than evaluating them on the sample. */
+    double moment_error;
+    if (sample_size == num_points || momentSquareError(simplified, moment_error)) return (*this)(chrom);
+
+    /* The same sample is used for every chromosome evaluated with the same fraction. */
+    std::shared_ptr<const Sample> sample = sampleOf(sample_size);
+
+    thread_local Program program;
+    Converter::chromosomeToProgram(simplified, program);
+
+    /* The sample might not contain the first and last points, so the function must be undefined everywhere to reject it. */
+    if (isUndefined(program, true)) return { 0.0 };
+
+    /* The terms of the term cache are evaluated on every data point, so it isn't used for the samples. The samples are sorted if the data is. */
+    double error = 0.0;
+    for (size_t first = 0; first < sample_size; first += block_size)
     {
-        double error_abs = std::abs(fx_actual[i] - fx_desired[i]);
-        error_abs = std::min(error_abs, std::numeric_limits<double>::max());
+        size_t len = std::min(block_size, sample_size - first);
+
+        const double* fx_actual = Decoder::evalProgram(program, sample->x.data() + first, len, precision_, x_sorted_);
 
-        mean += error_abs / double(fx_actual.size());
+        error = accumulateError(fx_actual, sample->fx_desired.data() + first, weights_ ? sample->weights.data() + first : nullptr, len, sample->total_weight, first == 0, error);
     }
 
-    return mean;
+    return { errorToFitness(error) };
+}
+
+std::shared_ptr<const FitnessFunction::Sample> FitnessFunction::sampleOf(size_t sample_size) const
+{
+    std::lock_guard<std::mutex> guard(samples_->lock);
+
+    for (const auto& sample : samples_->samples)
+    {
+        if (sample->x.size() == sample_size) return sample;
+    }
+
+    /* Take the middle point of each stratum. */
+    auto sample = std::make_shared<Sample>();
+    sample->x.resize(sample_size);
+    sample->fx_desired.resize(sample_size);
+    if (weights_) sample->weights.resize(sample_size);
+
+    for (size_t i = 0; i < sample_size; i++)
+    {
+        size_t idx = (2 * i + 1) * num_points_ / (2 * sample_size);
+
+        sample->x[i] = x_[idx];
+        sample->fx_desired[i] = fx_desired_[idx];
+        if (weights_) sample->weights[i] = weights_[idx];
+    }
+
+    /* The error metrics are normalized by the total weight of the sample. */
+    sample->total_weight = weights_ ? std::accumulate(sample->weights.begin(), sample->weights.end(), 0.0) : double(sample_size);
+
+    samples_->samples.push_back(sample);
+
+    return sample;
+}
+
+std::vector<Gene> FitnessFunction::fitLinearCoeffs(const std::vector<Gene>& chrom, const std::vector<std::pair<double, double>>& bounds) const
+{
+    assert(!chrom.empty());
+    assert(bounds.size() == std::tuple_size_v<coeffs_t>);
+
+    if (error_metric_ != Objective::LS && error_metric_ != Objective::RMSE) return chrom;
+
+    /* The buffers are reused between the calls on the same thread. */
+    thread_local std::vector<LinearTerm> terms;
+    thread_local std::vector<double> A;
+    thread_local std::vector<double> b;
+
+    std::vector<double> coeffs = linearDesignMatrix(chrom, terms, A, b);
+    if (coeffs.empty()) return chrom;
+
+    std::vector<double> solution = coeffs;
+    if (!solveLinearCoeffs(A, b, coeffs.size(), solution)) return chrom;
+
+    std::vector<Gene> fitted = chrom;
+    std::vector<double> used(coeffs.size(), 0.0);
+
+    /* The clamped solution is not optimal, and it might be worse than the current coefficients. */
+    if (writeLinearCoeffs(terms, solution, bounds, fitted, used))
+    {
+        const size_t num_points = num_points_;
+
+        auto squareError = [&](const std::vector<double>& column_coeffs)
+        {
+            double error = 0.0;
+            for (size_t i = 0; i < num_points; i++)
+            {
+                double fx = 0.0;
+                for (size_t k = 0; k < column_coeffs.size(); k++)
+                {
+                    fx += column_coeffs[k] * A[k * num_points + i];
+                }
+                error += (fx - b[i]) * (fx - b[i]);
+            }
+            return error;
+        };
+        if (!(squareError(used) <= squareError(coeffs))) return chrom;
+    }
+
+    return fitted;
+}
+
+std::vector<double> FitnessFunction::linearDesignMatrix(const std::vector<Gene>& chrom, std::vector<LinearTerm>& terms, std::vector<double>& A, std::vector<double>& b) const
+{
+    /* The terms of the function are separated by the + and - operators (the other operators have higher precedence). */
+    terms.clear();
+
+    double sign = 1.0;
+    for (size_t first = 0, i = 0; i < chrom.size(); i++)
+    {
+        /* The operator in the last gene is discarded. */
+        if (i == chrom.size() - 1 || chrom[i].opid == OP_ADD || chrom[i].opid == OP_SUB)
+        {
+            terms.push_back({ first, i, sign, LinearTerm::npos });
+            sign = (chrom[i].opid == OP_SUB) ? -1.0 : 1.0;
+            first = i + 1;
+        }
+    }
+    bool has_single = std::any_of(terms.begin(), terms.end(), [](const LinearTerm& term) { return term.first == term.last; });
+
+    /*
+    * The columns are the constant 1 (if there are single gene terms to hold it), sign*g(x) for the single gene terms with a*g(x) + d
+    * base functions, and sign*T(x) for the product terms T. The product terms starting with a power are fixed, as scaling the coefficients
+    * of their first gene doesn't scale the term, so they are subtracted from the right hand side instead.
+    */
+    const size_t num_points = num_points_;
+
+    A.clear();
+    b.assign(fx_desired_, fx_desired_ + num_points);
+
+    std::vector<double> coeffs;     /* The current coefficients of the columns. */
+
+    if (has_single)
+    {
+        A.resize(num_points, 1.0);
+        coeffs.push_back(0.0);
+    }
+    for (auto& term : terms)
+    {
+        const Gene& gene = chrom[term.first];
+
+        if (term.first == term.last)
+        {
+            coeffs[0] += term.sign * ((gene.fid == 0) ? gene.coeffs[2] : gene.coeffs[3]);
+
+            /* The constant function doesn't have an a coefficient. */
+            if (gene.fid == 0) continue;
+
+            Instruction operand;
+            operand.is_operator = false;
+            operand.fid = gene.fid;
+            operand.opid = _OP_MIN;
+            operand.coeffs = gene.coeffs;
+            operand.coeffs[0] = 1.0;
+            operand.coeffs[3] = 0.0;
+
+            size_t offset = A.size();
+            A.resize(offset + num_points);
+
+            /* The same terms appear in many candidates that only differ in their linear coefficients. */
+            TermCache::term_t cached = term_cache_->enabled() ? term_cache_->find(operand.fid, operand.coeffs) : nullptr;
+            if (cached)
+            {
+                std::copy(cached->begin(), cached->end(), A.begin() + offset);
+            }
+            else
+            {
+                Decoder::evalOperand(operand, x_, A.data() + offset, num_points, precision_, x_sorted_);
+                if (term_cache_->enabled()) term_cache_->insert(operand.fid, operand.coeffs, std::vector<double>(A.begin() + offset, A.end()));
+            }
+            std::for_each(A.begin() + offset, A.end(), [&](double& v) { v *= term.sign; });
+
+            term.column = coeffs.size();
+            coeffs.push_back(gene.coeffs[0]);
+        }
+        else
+        {
+            thread_local Program program;
+            Converter::chromosomeToProgram(std::vector<Gene>(chrom.begin() + term.first, chrom.begin() + term.last + 1), program);
+            const double* fx = Decoder::evalProgram(program, x_, num_points, precision_, x_sorted_);
+
+            if (gene.opid == OP_POW)
+            {
+                for (size_t i = 0; i < num_points; i++) b[i] -= term.sign * fx[i];
+                continue;
+            }
+            size_t offset = A.size();
+            A.resize(offset + num_points);
+            for (size_t i = 0; i < num_points; i++) A[offset + i] = term.sign * fx[i];
+
+            term.column = coeffs.size();
+            coeffs.push_back(1.0);
+        }
+    }
+
+    /* The weighted problem is solved by scaling the rows by the square roots of the weights. */
+    if (weights_ && !coeffs.empty())
+    {
+        for (size_t i = 0; i < num_points; i++)
+        {
+            const double scale = std::sqrt(weights_[i]);
+
+            b[i] *= scale;
+            for (size_t k = 0; k < coeffs.size(); k++)
+            {
+                A[k * num_points + i] *= scale;
+            }
+        }
+    }
+
+    return coeffs;
+}
+
+bool FitnessFunction::solveLinearCoeffs(const std::vector<double>& A, const std::vector<double>& b, size_t num_columns, std::vector<double>& solution) const
+{
+    /* The solver overwrites the matrix, but the caller keeps it for calculating the errors of the coefficients. */
+    thread_local std::vector<double> A_qr;
+    thread_local std::vector<double> b_qr;
+    A_qr = A;
+    b_qr = b;
+
+    /* The linearly dependent columns keep their current coefficients. */
+    return LeastSquares::solve(A_qr, num_points_, num_columns, b_qr, solution);
+}
+
+bool FitnessFunction::writeLinearCoeffs(const std::vector<LinearTerm>& terms, const std::vector<double>& solution, const std::vector<std::pair<double, double>>& bounds,
+                                        std::vector<Gene>& chrom, std::vector<double>& used)
+{
+    /*
+    * The whole constant of the solution is put in a single term: the first constant gene, or the first single gene term if there are none.
+    * Only the part of it that doesn't fit within the bounds of that term is split between the other single gene terms.
+    */
+    std::vector<size_t> single_terms;
+    for (size_t i = 0; i < terms.size(); i++)
+    {
+        if (terms[i].first == terms[i].last) single_terms.push_back(i);
+    }
+    auto constant_gene = std::find_if(single_terms.begin(), single_terms.end(), [&](size_t i) { return chrom[terms[i].first].fid == 0; });
+    if (constant_gene != single_terms.end()) std::rotate(single_terms.begin(), constant_gene, constant_gene + 1);
+
+    std::vector<double> constants(terms.size(), 0.0);
+    double constant_left = single_terms.empty() ? 0.0 : solution[0];
+    for (size_t i : single_terms)
+    {
+        size_t d_idx = (chrom[terms[i].first].fid == 0) ? 2 : 3;
+
+        constants[i] = std::clamp(terms[i].sign * constant_left, bounds[d_idx].first, bounds[d_idx].second);
+        constant_left -= terms[i].sign * constants[i];
+    }
+
+    bool clamped = (constant_left != 0.0);
+    auto setCoeff = [&bounds, &clamped](Gene& gene, size_t idx, double value)
+    {
+        gene.coeffs[idx] = std::clamp(value, bounds[idx].first, bounds[idx].second);
+        clamped = clamped || (gene.coeffs[idx] != value);
+    };
+
+    for (size_t i = 0; i < terms.size(); i++)
+    {
+        const LinearTerm& term = terms[i];
+        Gene& gene = chrom[term.first];
+
+        if (term.first == term.last)
+        {
+            size_t d_idx = (gene.fid == 0) ? 2 : 3;
+            setCoeff(gene, d_idx, constants[i]);
+            used[0] += term.sign * gene.coeffs[d_idx];
+
+            if (gene.fid == 0) continue;
+
+            setCoeff(gene, 0, solution[term.column]);
+            used[term.column] = gene.coeffs[0];
+        }
+        else if (term.column != LinearTerm::npos)
+        {
+            /*
+            * The product term is scaled by scaling the coefficients of the first factor. The scale is limited
+            * so that none of them have to be clamped, otherwise the term wouldn't be scaled.
+            */
+            const std::vector<size_t> scaled = (gene.fid == 0) ? std::vector<size_t>{ 2 } : std::vector<size_t>{ 0, 3 };
+
+            double scale_min = -std::numeric_limits<double>::infinity();
+            double scale_max = std::numeric_limits<double>::infinity();
+
+            for (size_t idx : scaled)
+            {
+                double v = gene.coeffs[idx];
+                if (v == 0.0) continue;
+
+                double lo = bounds[idx].first / v;
+                double hi = bounds[idx].second / v;
+                scale_min = std::max(scale_min, std::min(lo, hi));
+                scale_max = std::min(scale_max, std::max(lo, hi));
+            }
+
+            double scale = (scale_min <= scale_max) ? std::clamp(solution[term.column], scale_min, scale_max) : 1.0;
+            clamped = clamped || (scale != solution[term.column]);
+
+            for (size_t idx : scaled)
+            {
+                gene.coeffs[idx] *= scale;
+            }
+            used[term.column] = scale;
+        }
+    }
+
+    return clamped;
+}
+
+template<typename F>
+void FitnessFunction::forEachJacobianBlock(const Program& program, F&& f) const
+{
+    const size_t num_params = Differentiator::num_coeffs * size_t(std::count_if(program.code.begin(), program.code.end(), [](const Instruction& instruction) { return !instruction.is_operator; }));
+    const size_t num_points = num_points_;
+
+    /* The buffers are reused between the calls on the same thread. */
+    thread_local std::vector<double> fx;
+    thread_local std::vector<double> jacobian;
+
+    fx.resize(std::max(fx.size(), block_size));
+    jacobian.resize(std::max(jacobian.size(), block_size * num_params));
+
+    for (size_t first = 0; first < num_points; first += block_size)
+    {
+        size_t len = std::min(block_size, num_points - first);
+
+        Differentiator::evalJacobian(program, x_ + first, len, fx.data(), jacobian.data(), precision_);
+        f(first, len, fx.data(), jacobian.data());
+    }
+}
+
+std::vector<Gene> FitnessFunction::refineCoeffs(const std::vector<Gene>& chrom, const std::vector<std::pair<double, double>>& bounds, size_t max_evals) const
+{
+    assert(!chrom.empty());
+    assert(bounds.size() == Differentiator::num_coeffs);
+
+    constexpr size_t num_coeffs = Differentiator::num_coeffs;
+    const size_t num_params = num_coeffs * chrom.size();
+
+    /* The program and the buffers are reused between the calls on the same thread. */
+    thread_local Program program;
+    thread_local std::vector<double> JtJ;
+    thread_local std::vector<double> Jtr;
+    thread_local std::vector<double> A;
+    thread_local std::vector<double> b;
+    thread_local std::vector<double> row_weights;
+
+    std::vector<Gene> best = chrom;
+    double best_fitness = trialFitness(best);
+    size_t num_evals = 1;
+
+    /* Undefined functions can't be improved by small steps. */
+    if (best_fitness == 0.0 || num_evals >= max_evals) return best;
+
+    /* LAD and MINMAX are not sums of squares, so they are not minimized by the Gauss-Newton steps. Their coefficients are refined along their gradients instead. */
+    if (error_metric_ == Objective::LAD || error_metric_ == Objective::MINMAX) return descendCoeffs(best, best_fitness, bounds, max_evals - num_evals);
+
+    double lambda = 1E-3;   /* The damping factor of the steps. */
+    while (num_evals < max_evals)
+    {
+        /* Accumulate J^T*J and J^T*r over the blocks of the data points, where J is the Jacobian and r the residuals. */
+        Converter::chromosomeToProgram(best, program);
+
+        JtJ.assign(num_params * num_params, 0.0);
+        Jtr.assign(num_params, 0.0);
+
+        forEachJacobianBlock(program, [&](size_t first, size_t len, const double* fx, const double* jacobian)
+        {
+            /*
+            * With weighted points, J^T*W*J and J^T*W*r are accumulated instead. The rows where the function or any of its derivatives
+            * is not finite are dropped (their weight is 0), otherwise a single point would make the whole system undefined.
+            */
+            row_weights.resize(std::max(row_weights.size(), len));
+            for (size_t i = 0; i < len; i++)
+            {
+                bool finite = std::isfinite(fx[i]);
+                for (size_t j = 0; j < num_params && finite; j++)
+                {
+                    finite = std::isfinite(jacobian[j * len + i]);
+                }
+                row_weights[i] = !finite ? 0.0 : (weights_ ? weights_[first + i] : 1.0);
+            }
+
+            for (size_t j = 0; j < num_params; j++)
+            {
+                const double* col_j = jacobian + j * len;
+                for (size_t i = 0; i < len; i++)
+                {
+                    if (row_weights[i] != 0.0) Jtr[j] += col_j[i] * (fx_desired_[first + i] - fx[i]) * row_weights[i];
+                }
+                /* Only the lower triangle of the symmetric matrix is accumulated. */
+                for (size_t k = 0; k <= j; k++)
+                {
+                    const double* col_k = jacobian + k * len;
+
+                    double sum = 0.0;
+                    for (size_t i = 0; i < len; i++)
+                    {
+                        if (row_weights[i] != 0.0) sum += col_j[i] * col_k[i] * row_weights[i];
+                    }
+                    JtJ[k * num_params + j] += sum;
+                }
+            }
+        });
+        num_evals++;
+
+        for (size_t j = 0; j < num_params; j++)
+        {
+            for (size_t k = 0; k < j; k++)
+            {
+                JtJ[j * num_params + k] = JtJ[k * num_params + j];
+            }
+        }
+
+        /* Try steps with increasing damping until one of them improves the fitness. */
+        bool improved = false;
+        while (!improved && num_evals < max_evals)
+        {
+            /*
+            * Solve (J^T*J + lambda*diag(J^T*J))*step = J^T*r. The coefficients not affecting the function have zero columns,
+            * so they are linearly dependent, and their steps are left 0 by the solver.
+            */
+            A = JtJ;
+            b = Jtr;
+            for (size_t j = 0; j < num_params; j++)
+            {
+                A[j * num_params + j] *= 1.0 + lambda;
+            }
+            std::vector<double> step(num_params, 0.0);
+            if (!LeastSquares::solve(A, num_params, num_params, b, step)) return best;
+
+            std::vector<Gene> candidate = best;
+            for (size_t k = 0; k < candidate.size(); k++)
+            {
+                for (size_t j = 0; j < num_coeffs; j++)
+                {
+                    double& coeff = candidate[k].coeffs[j];
+                    coeff = std::clamp(coeff + step[k * num_coeffs + j], bounds[j].first, bounds[j].second);
+                }
+            }
+            /* The step doesn't change the coefficients if it is too small, or they are at their bounds. */
+            bool changed = (candidate != best);
+
+            double candidate_fitness = changed ? trialFitness(candidate) : best_fitness;
+            if (changed) num_evals++;
+
+            if (candidate_fitness > best_fitness)
+            {
+                best = std::move(candidate);
+                best_fitness = candidate_fitness;
+                lambda = std::max(lambda / 10.0, 1E-12);
+                improved = true;
+            }
+            else
+            {
+                lambda *= 10.0;
+                if (lambda > 1E12) return best;
+            }
+        }
+    }
+
+    return best;
 }
 
-double FitnessFunction::rootMeanSquareError(const std::vector<double>& fx_actual, const std::vector<double>& fx_desired)
+std::vector<Gene> FitnessFunction::descendCoeffs(const std::vector<Gene>& chrom, double fitness, const std::vector<std::pair<double, double>>& bounds, size_t max_evals) const
 {
-    assert(fx_actual.size() == fx_desired.size());
+    constexpr size_t num_coeffs = Differentiator::num_coeffs;
 
-    double mean = 0.0;
-    for (size_t i = 0; i < fx_actual.size(); i++)
+    std::vector<Gene> best = chrom;
+    double best_fitness = fitness;
+    size_t num_evals = 0;
+
+    /* The length of the steps, doubled after each successful step and reduced after each failed one. */
+    double step_length = 0.1;
+    while (num_evals < max_evals)
     {
-        double error_sq = (fx_actual[i] - fx_desired[i]) * (fx_actual[i] - fx_desired[i]);
+        std::vector<double> gradient = errorGradient(best);
+        num_evals++;
+
+        double norm = std::sqrt(std::inner_product(gradient.begin(), gradient.end(), gradient.begin(), 0.0));
+        if (!(norm > 0.0 && std::isfinite(norm))) return best;
+
+        /* Try shorter steps against the gradient until one of them improves the fitness. */
+        bool improved = false;
+        while (!improved && num_evals < max_evals)
+        {
+            std::vector<Gene> candidate = best;
+            for (size_t k = 0; k < candidate.size(); k++)
+            {
+                for (size_t j = 0; j < num_coeffs; j++)
+                {
+                    double& coeff = candidate[k].coeffs[j];
+                    coeff = std::clamp(coeff - step_length * gradient[k * num_coeffs + j] / norm, bounds[j].first, bounds[j].second);
+                }
+            }
+            /* The step doesn't change the coefficients if it is too small, or they are at their bounds. */
+            if (candidate == best) return best;
+
+            double candidate_fitness = trialFitness(candidate);
+            num_evals++;
+
+            if (candidate_fitness > best_fitness)
+            {
+                best = std::move(candidate);
+                best_fitness = candidate_fitness;
+                step_length *= 2.0;
+                improved = true;
+            }
+            else
+            {
+                step_length /= 4.0;
+            }
+        }
+    }
+
+    return best;
+}
+
+double FitnessFunction::trialFitness(const std::vector<Gene>& chrom) const
+{
+    /* The chromosome is simplified and its error calculated the same way as by the fitness function call, so the fitness is the same. */
+    thread_local std::vector<Gene> simplified;
+    Simplifier::simplify(chrom, simplified, precision_);
+
+    double moment_error;
+    if (momentSquareError(simplified, moment_error)) return errorToFitness(moment_error);
+
+    thread_local Program program;
+    Converter::chromosomeToProgram(simplified, program);
+
+    if (isUndefined(program, error_metric_ == Objective::MINMAX)) return 0.0;
+
+    const size_t num_points = num_points_;
+
+    double error = 0.0;
+    for (size_t first = 0; first < num_points; first += block_size)
+    {
+        size_t len = std::min(block_size, num_points - first);
+
+        const double* fx_actual = Decoder::evalProgram(program, x_ + first, len, precision_, x_sorted_);
+        error = accumulateError(fx_actual, fx_desired_ + first, weights_ ? weights_ + first : nullptr, len, total_weight_, first == 0, error);
+    }
+
+    return errorToFitness(error);
+}
+
+std::vector<double> FitnessFunction::errorGradient(const std::vector<Gene>& chrom) const
+{
+    assert(!chrom.empty());
+
+    thread_local Program program;
+    Converter::chromosomeToProgram(chrom, program);
+
+    const size_t num_params = Differentiator::num_coeffs * chrom.size();
+
+    std::vector<double> gradient(num_params, 0.0);
+    double square_error = 0.0;      /* Used for the gradient of RMSE. */
+    double error_max = -1.0;        /* Used for the gradient of MINMAX. */
+
+    /* The derivatives of the error metric with respect to the values of the function at each point of the block. */
+    thread_local std::vector<double> weights;
+    weights.resize(std::max(weights.size(), block_size));
+
+    forEachJacobianBlock(program, [&](size_t first, size_t len, const double* fx, const double* jacobian)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            double residual = fx[i] - fx_desired_[first + i];
+            double w = weights_ ? weights_[first + i] : 1.0;
+
+            switch (error_metric_)
+            {
+                case Objective::LS:
+                case Objective::RMSE:
+                    weights[i] = 2.0 * residual * w / total_weight_;
+                    square_error += residual * residual * w / total_weight_;
+                    break;
+                case Objective::LAD:
+                    weights[i] = (residual > 0.0) ? w / total_weight_ : ((residual < 0.0) ? -w / total_weight_ : 0.0);
+                    break;
+                case Objective::MINMAX:
+                    /* The points where the function is undefined are ignored by MINMAX (except the first one). */
+                    weights[i] = 0.0;
+                    if (std::abs(residual) > error_max)
+                    {
+                        error_max = std::abs(residual);
+                        double sign = (residual < 0.0) ? -1.0 : 1.0;
+                        for (size_t j = 0; j < num_params; j++)
+                        {
+                            gradient[j] = sign * jacobian[j * len + i];
+                        }
+                    }
+                    break;
+                default:
+                    assert(false);	/* Invalid objective, shouldn't get here. */
+                    std::abort();
+            }
+        }
+        if (error_metric_ == Objective::MINMAX) return;
+
+        for (size_t j = 0; j < num_params; j++)
+        {
+            for (size_t i = 0; i < len; i++)
+            {
+                gradient[j] += weights[i] * jacobian[j * len + i];
+            }
+        }
+    });
+
+    /* d(sqrt(E))/dc = dE/dc / (2*sqrt(E)) */
+    if (error_metric_ == Objective::RMSE)
+    {
+        double scale = 1.0 / (2.0 * std::sqrt(square_error));
+        std::for_each(gradient.begin(), gradient.end(), [scale](double& g) { g *= scale; });
+    }
+
+    return gradient;
+}
+
+std::vector<double> FitnessFunction::sensitivities(const std::vector<Gene>& chrom) const
+{
+    assert(!chrom.empty());
+
+    thread_local Program program;
+    Converter::chromosomeToProgram(chrom, program);
+
+    const size_t num_params = Differentiator::num_coeffs * chrom.size();
+
+    std::vector<double> mean_squares(num_params, 0.0);
+
+    forEachJacobianBlock(program, [&](size_t first, size_t len, const double*, const double* jacobian)
+    {
+        for (size_t j = 0; j < num_params; j++)
+        {
+            for (size_t i = 0; i < len; i++)
+            {
+                mean_squares[j] += jacobian[j * len + i] * jacobian[j * len + i] * (weights_ ? weights_[first + i] : 1.0) / total_weight_;
+            }
+        }
+    });
+
+    std::for_each(mean_squares.begin(), mean_squares.end(), [](double& ms) { ms = std::sqrt(ms); });
+
+    return mean_squares;
+}
+
+void FitnessFunction::lookupTerms(const Program& program, std::vector<TermCache::term_t>& terms, std::vector<const double*>& values, std::vector<NewTerm>& new_terms) const
+{
+    terms.clear();
+    values.clear();
+    new_terms.clear();
+
+    for (const auto& instruction : program.code)
+    {
+        if (instruction.is_operator) continue;
+
+        TermCache::term_t term = term_cache_->find(instruction.fid, instruction.coeffs);
+        if (term)
+        {
+            values.push_back(term->data());
+            terms.push_back(std::move(term));
+        }
+        else
+        {
+            /* Moving the vectors of new_terms when it grows doesn't move their values, so the pointers stay valid. */
+            new_terms.push_back({ &instruction, std::vector<double>(num_points_) });
+            values.push_back(new_terms.back().values.data());
+            terms.push_back(nullptr);
+        }
+    }
+}
+
+void FitnessFunction::evalNewTerms(std::vector<NewTerm>& new_terms, size_t first, size_t len) const
+{
+    for (auto& term : new_terms)
+    {
+        Decoder::evalOperand(*term.operand, x_ + first, term.values.data() + first, len, precision_, x_sorted_);
+    }
+}
+
+void FitnessFunction::storeNewTerms(std::vector<NewTerm>& new_terms) const
+{
+    for (auto& term : new_terms)
+    {
+        term_cache_->insert(term.operand->fid, term.operand->coeffs, std::move(term.values));
+    }
+    new_terms.clear();
+}
+
+double FitnessFunction::accumulateError(const double* fx_actual, const double* fx_desired, const double* weights, size_t len, double total_weight, bool first_block, double error) const
+{
+    switch (error_metric_)
+    {
+        case Objective::LS:
+            return squareErrorMean(fx_actual, fx_desired, weights, len, total_weight, error);
+        case Objective::LAD:
+            return absoluteErrorMean(fx_actual, fx_desired, weights, len, total_weight, error);
+        case Objective::RMSE:
+            return squareErrorMean(fx_actual, fx_desired, weights, len, total_weight, error);
+        case Objective::MINMAX:
+            if (first_block) error = std::abs(fx_actual[0] - fx_desired[0]);
+            return maximumError(fx_actual, fx_desired, len, error);
+        default:
+            assert(false);	/* Invalid objective, shouldn't get here. */
+            std::abort();
+    }
+}
+
+double FitnessFunction::errorToFitness(double error) const
+{
+    if (error_metric_ == Objective::RMSE) error = std::sqrt(error);
+    if (error_metric_ == Objective::MINMAX) error = std::min(error, std::numeric_limits<double>::max());
+
+    return std::isnan(error) ? 0.0 : 1.0 / error;
+}
+
+bool FitnessFunction::isUndefined(const Program& program, bool everywhere) const
+{
+    DomainAnalysis::Result result = DomainAnalysis::analyseProgram(program, x_min_, x_max_);
+
+    bool undefined = everywhere ? result.everywhere : (result.at_min || result.at_max || result.everywhere);
+    if (!undefined) return false;
+
+    nan_counters_->rejected++;
+    for (const auto& instruction : program.code)
+    {
+        if (instruction.is_operator) continue;
+
+        DomainAnalysis::Result operand = DomainAnalysis::analyseOperand(instruction, x_min_, x_max_);
+        if (operand.at_min || operand.at_max) nan_counters_->rejected_funcs[instruction.fid]++;
+    }
+
+    return true;
+}
+
+bool FitnessFunction::momentSquareError(const std::vector<Gene>& chrom, double& error) const
+{
+    assert(!chrom.empty());
+
+    if (error_metric_ != Objective::LS && error_metric_ != Objective::RMSE) return false;
+
+    /*
+    * The coefficients of the powers of x in the polynomial, the coefficient of x^k is at index k + max_moment_power,
+    * and the sums of the absolute values of the coefficients of the genes they are added from.
+    */
+    std::array<double, 2 * max_moment_power + 1> poly_coeffs{};
+    std::array<double, 2 * max_moment_power + 1> poly_abs_coeffs{};
+
+    double sign = 1.0;
+    for (size_t i = 0; i < chrom.size(); i++)
+    {
+        const Gene& gene = chrom[i];
+        const coeffs_t& coeffs = gene.coeffs;
+
+        /* The operator in the last gene is discarded. */
+        if (i != chrom.size() - 1 && gene.opid != OP_ADD && gene.opid != OP_SUB) return false;
+
+        switch (gene.fid)
+        {
+            case 0:     /* f(x) = c */
+                poly_coeffs[max_moment_power] += sign * coeffs[2];
+                poly_abs_coeffs[max_moment_power] += std::abs(coeffs[2]);
+                break;
+            case 1:     /* f(x) = a*x + d */
+                poly_coeffs[max_moment_power + 1] += sign * coeffs[0];
+                poly_coeffs[max_moment_power] += sign * coeffs[3];
+                poly_abs_coeffs[max_moment_power + 1] += std::abs(coeffs[0]);
+                poly_abs_coeffs[max_moment_power] += std::abs(coeffs[3]);
+                break;
+            case 2:     /* f(x) = a*x^n + d */
+                if (!(std::abs(coeffs[4]) <= max_moment_power) || coeffs[4] != std::round(coeffs[4])) return false;
+                /* The function is undefined if some x is 0 and the exponent is negative, even if a is 0. */
+                if (!std::isfinite(x_moments_[2 * max_moment_power + int(coeffs[4])])) return false;
+                poly_coeffs[max_moment_power + int(coeffs[4])] += sign * coeffs[0];
+                poly_coeffs[max_moment_power] += sign * coeffs[3];
+                poly_abs_coeffs[max_moment_power + int(coeffs[4])] += std::abs(coeffs[0]);
+                poly_abs_coeffs[max_moment_power] += std::abs(coeffs[3]);
+                break;
+            default:
+                return false;
+        }
+        sign = (gene.opid == OP_SUB) ? -1.0 : 1.0;
+    }
+
+    /*
+    * mean((f - y)^2) = mean(f^2) - 2*mean(f*y) + mean(y^2), where f^2 and f*y are sums of the moments times the products of the coefficients.
+    * The magnitude is the same sum calculated from the abs coefficients and abs moments, the rounding errors of the moments, the coefficients,
+    * and the products and sums of the terms are all bounded by a multiple of it.
+    */
+    double f2_moment = 0.0;
+    double fy_moment = 0.0;
+    double magnitude = y2_moment_;
+    size_t num_terms = 1;
+    for (int p = -max_moment_power; p <= max_moment_power; p++)
+    {
+        double coeff_p = poly_coeffs[p + max_moment_power];
+        double abs_coeff_p = poly_abs_coeffs[p + max_moment_power];
+        if (abs_coeff_p == 0.0) continue;
+
+        fy_moment += coeff_p * xy_moments_[p + 2 * max_moment_power];
+        magnitude += 2.0 * abs_coeff_p * xy_abs_moments_[p + 2 * max_moment_power];
+        num_terms++;
+
+        for (int q = -max_moment_power; q <= max_moment_power; q++)
+        {
+            double coeff_q = poly_coeffs[q + max_moment_power];
+            double abs_coeff_q = poly_abs_coeffs[q + max_moment_power];
+            if (abs_coeff_q == 0.0) continue;
+
+            f2_moment += coeff_p * coeff_q * x_moments_[p + q + 2 * max_moment_power];
+            magnitude += abs_coeff_p * abs_coeff_q * x_abs_moments_[p + q + 2 * max_moment_power];
+            num_terms++;
+        }
+    }
+    double moment_error = f2_moment - 2.0 * fy_moment + y2_moment_;
+
+    /*
+    * The error bound (to first order in eps): each coefficient is the sum of at most chrom.size() values, the products of the terms take
+    * 3 roundings, the terms are summed in num_terms + 2 additions, and the moments are accurate to moment_rounding_ times the abs moments.
+    * The error is calculated from the moments only if its relative error is certainly below the tolerance, so that it
+    * can be compared with the errors of the evaluated chromosomes.
+    */
+    constexpr double eps = std::numeric_limits<double>::epsilon() / 2.0;
+    constexpr double tolerance = 1E-8;
+
+    double error_bound = ((2.0 * chrom.size() + num_terms + 5.0) * eps + moment_rounding_) * magnitude;
+    if (!std::isfinite(moment_error) || !std::isfinite(error_bound) || !(error_bound < tolerance * moment_error)) return false;
+
+    error = moment_error;
+
+    return true;
+}
+
+void FitnessFunction::updateRange()
+{
+    assert(num_points_ > 0);
+
+    /* The summary of the binary data files is read from their headers, which avoids 2 passes over the data. */
+    if (const auto& summary = data_->summary())
+    {
+        x_min_ = summary->x_min;
+        x_max_ = summary->x_max;
+        x_sorted_ = summary->x_sorted;
+        return;
+    }
+
+    auto [x_min, x_max] = std::minmax_element(x_, x_ + num_points_);
+    x_min_ = *x_min;
+    x_max_ = *x_max;
+    x_sorted_ = std::is_sorted(x_, x_ + num_points_);
+}
+
+void FitnessFunction::updateMoments()
+{
+    const size_t num_points = num_points_;
+
+    /*
+    * The odd moments can cancel, so they are summed with compensated summation to keep their error independent of the number of points.
+    * The abs moments are only used in the error bounds, so they are summed directly.
+    */
+    std::array<CompensatedSum, 4 * max_moment_power + 1> x_sums;
+    std::array<CompensatedSum, 4 * max_moment_power + 1> xy_sums;
+    CompensatedSum y2_sum;
+
+    x_abs_moments_.fill(0.0);
+    xy_abs_moments_.fill(0.0);
+
+    for (size_t i = 0; i < num_points; i++)
+    {
+        const double x = x_[i];
+        const double y = fx_desired_[i];
+        const double w = weights_ ? weights_[i] : 1.0;
+
+        x_sums[2 * max_moment_power].add(w);
+        xy_sums[2 * max_moment_power].add(w * y);
+        y2_sum.add(w * y * y);
+        x_abs_moments_[2 * max_moment_power] += w;
+        xy_abs_moments_[2 * max_moment_power] += std::abs(w * y);
+
+        double x_pow = 1.0;
+        double x_inv_pow = 1.0;
+        for (int k = 1; k <= 2 * max_moment_power; k++)
+        {
+            x_pow *= x;
+            x_inv_pow /= x;
+
+            x_sums[2 * max_moment_power + k].add(w * x_pow);
+            xy_sums[2 * max_moment_power + k].add(w * x_pow * y);
+            x_sums[2 * max_moment_power - k].add(w * x_inv_pow);
+            xy_sums[2 * max_moment_power - k].add(w * x_inv_pow * y);
+
+            x_abs_moments_[2 * max_moment_power + k] += std::abs(w * x_pow);
+            xy_abs_moments_[2 * max_moment_power + k] += std::abs(w * x_pow * y);
+            x_abs_moments_[2 * max_moment_power - k] += std::abs(w * x_inv_pow);
+            xy_abs_moments_[2 * max_moment_power - k] += std::abs(w * x_inv_pow * y);
+        }
+    }
+
+    for (size_t k = 0; k < x_moments_.size(); k++)
+    {
+        x_moments_[k] = x_sums[k].value() / total_weight_;
+        xy_moments_[k] = xy_sums[k].value() / total_weight_;
+        x_abs_moments_[k] /= total_weight_;
+        xy_abs_moments_[k] /= total_weight_;
+    }
+    y2_moment_ = y2_sum.value() / total_weight_;
+
+    /*
+    * The bound of the rounding errors of the moments relative to their abs moments: the terms take at most 2*max_moment_power + 2 roundings,
+    * the compensated sums add 2*eps + 4*n*eps^2, and the division 1 more. The abs moments themselves are accurate to n*eps, which is included too.
+    */
+    constexpr double eps = std::numeric_limits<double>::epsilon() / 2.0;
+    moment_rounding_ = (2 * max_moment_power + 5) * eps + 4.0 * num_points * eps * eps;
+    moment_rounding_ *= 1.0 + (num_points + 2.0) * eps;
+}
+
+/* Objective functions. */
+
+double FitnessFunction::squareErrorMean(const double* fx_actual, const double* fx_desired, const double* weights, size_t len, double total_weight, double mean)
+{
+    if (weights == nullptr)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            double error_sq = (fx_actual[i] - fx_desired[i]) * (fx_actual[i] - fx_desired[i]);
+            error_sq = std::min(error_sq, std::numeric_limits<double>::max());
+
+            mean += error_sq / total_weight;
+        }
+
+        return mean;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        double error_sq = weights[i] * (fx_actual[i] - fx_desired[i]) * (fx_actual[i] - fx_desired[i]);
         error_sq = std::min(error_sq, std::numeric_limits<double>::max());
 
-        mean += error_sq / double(fx_actual.size());
+        mean += error_sq / total_weight;
     }
 
-    return std::sqrt(mean);
+    return mean;
 }
 
-double FitnessFunction::maximumError(const std::vector<double>& fx_actual, const std::vector<double>& fx_desired)
+double FitnessFunction::absoluteErrorMean(const double* fx_actual, const double* fx_desired, const double* weights, size_t len, double total_weight, double mean)
 {
-    assert(fx_actual.size() == fx_desired.size());
+    if (weights == nullptr)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            double error_abs = std::abs(fx_actual[i] - fx_desired[i]);
+            error_abs = std::min(error_abs, std::numeric_limits<double>::max());
+
+            mean += error_abs / total_weight;
+        }
 
-    double error_max = std::abs(fx_actual[0] - fx_desired[0]);
-    for (size_t i = 1; i < fx_actual.size(); i++)
+        return mean;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        double error_abs = weights[i] * std::abs(fx_actual[i] - fx_desired[i]);
+        error_abs = std::min(error_abs, std::numeric_limits<double>::max());
+
+        mean += error_abs / total_weight;
+    }
+
+    return mean;
+}
+
+double FitnessFunction::maximumError(const double* fx_actual, const double* fx_desired, size_t len, double error_max)
+{
+    for (size_t i = 0; i < len; i++)
     {
         error_max = std::max(error_max, std::abs(fx_actual[i] - fx_desired[i]));
     }
 
-    return std::min(error_max, std::numeric_limits<double>::max());
+    return error_max;
 }
\ No newline at end of file
@@ -5,9 +5,20 @@
 #ifndef FITNESS_FUNCTION_H
 #define FITNESS_FUNCTION_H
 
+#include "decoder.h"
+#include "program.h"
+#include "term_cache.h"
+#include "term_records.h"
+#include "dataset.h"
 #include "../genetic/gene.h"
 
 #include <vector>
+#include <utility>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
 
 /* The fitness function used in the GA. */
 class FitnessFunction
@@ -27,25 +38,295 @@ public:
     FitnessFunction() = delete;
     FitnessFunction(const std::vector<double>& x, const std::vector<double>& fx_desired, Objective error_metric);
 
+    /*
+    * Use the points of data without copying them. The dataset is shared between the copies of the fitness function.
+    * If the points are weighted, the error metrics are the weighted means of the errors (the weights don't affect MINMAX),
+    * and the coefficients are fitted by weighted least squares.
+    */
+    FitnessFunction(std::shared_ptr<const Dataset> data, Objective error_metric);
+
     /* Setters. */
     void data(const std::vector<double>& x, const std::vector<double>& fx_desired);
+    void data(std::shared_ptr<const Dataset> data);
     void error_metric(Objective error_metric);
+    void precision(Decoder::Precision precision);
+
+    /*
+    * Set the max memory used by the cached values of the base function terms in bytes (0 disables the cache, this is the default).
+    * The cached terms don't have to be evaluated again when they appear in other chromosomes.
+    */
+    void term_cache_memory(size_t max_bytes);
+
+    /*
+    * Set the max memory used by the records of the evaluated chromosomes in bytes (0 disables them, this is the default).
+    * The records contain the values of the base function terms of the chromosomes, and are used by the incremental evaluation of their children.
+    */
+    void term_records_memory(size_t max_bytes);
+
+    /* Getters. */
+    const TermCache& term_cache() const noexcept;
+    const TermRecords& term_records() const noexcept;
+
+    /* The range of the x values of the data points. */
+    double x_min() const noexcept;
+    double x_max() const noexcept;
+
+    /* The number of chromosomes that were not evaluated, because they are certainly undefined (NaN) at some of the data points. */
+    size_t num_rejected() const noexcept;
+
+    /* The number of rejected chromosomes containing an undefined term of each base function. */
+    std::vector<size_t> rejected_funcs() const;
+
+    /* The number of evaluated chromosomes that were undefined at some of the data points. */
+    size_t num_undefined() const noexcept;
 
     /* Calc the fitness of chrom (higher is better). */
     std::vector<double> operator()(const std::vector<Gene>& chrom) const;
 
+    /*
+    * Calc the fitness of chrom, but stop the evaluation as soon as the fitness is certain to be lower than threshold.
+    * The errors are accumulated over the blocks of the data points, and the error over the points evaluated so far is a lower bound
+    * of the error over every point. If the fitness calculated from this bound is lower than threshold, it is returned
+    * without evaluating the rest of the points. Otherwise the result is the same as the fitness of chrom.
+    */
+    std::vector<double> operator()(const std::vector<Gene>& chrom, double threshold) const;
+
+    /*
+    * Calc the fitness of chrom incrementally from the record of parent (the chromosome chrom was created from, empty if there isn't one),
+    * stopping early like the other overload if the fitness is certain to be lower than threshold. Only the base function terms of the genes
+    * that are not in the record of parent are evaluated, the values of the others are reused, and the function is recombined from them.
+    * The record of chrom is added to the term records if it was evaluated on every point. The result is the same as the fitness of chrom.
+    * If the term records are disabled, chrom is evaluated without them.
+    */
+    std::vector<double> operator()(const std::vector<Gene>& chrom, const std::vector<Gene>& parent, double threshold) const;
+
+    /*
+    * Calc the fitness of every chromosome in chroms, returning them in the same order. The results are the same as the fitness of each chromosome.
+    * Every chromosome is evaluated on a block of the data points before moving on to the next block, so each block of
+    * the data is only loaded into the cache once for the whole batch. If the data points are streamed from a memory mapped file,
+    * evaluating the whole population in a single batch reads every block of the file only once per generation.
+    */
+    std::vector<std::vector<double>> operator()(const std::vector<std::vector<Gene>>& chroms) const;
+
+    /*
+    * Approximate the fitness of chrom by evaluating it on a stratified sample containing fraction part of the data points (0 < fraction <= 1).
+    * The data points are split into consecutive strata of equal size, and the middle point of each stratum is used. The sample always
+    * contains at least min_sample_size points (or every point), and the result is the same as the fitness of chrom if every point is used.
+    */
+    std::vector<double> evaluateSample(const std::vector<Gene>& chrom, double fraction) const;
+
+    /*
+    * Returns chrom with the coefficients that enter the function linearly set to the values minimizing the square error (variable projection).
+    * The function is split into the terms separated by the + and - operators. The a and d coefficients of the terms made of a single gene, and
+    * a common scale factor of each product term (applied to the a and d coefficients of its first gene) are solved by least squares with the
+    * other coefficients fixed. The constant part of the solution is put in a single term (a constant gene if there is one), and the results are
+    * clamped to bounds (the bounds of the coefficients of the genes), in which case the solution is only used if it is better than chrom.
+    * Every term is evaluated at every data point to solve the coefficients, so it is best used on a few of the candidates, eg. in a local search.
+    * Only used with the LS and RMSE error metrics, otherwise chrom is returned unchanged.
+    */
+    std::vector<Gene> fitLinearCoeffs(const std::vector<Gene>& chrom, const std::vector<std::pair<double, double>>& bounds) const;
+
+    /*
+    * Returns chrom with the coefficients of its genes refined by the Levenberg-Marquardt method, using the exact derivatives of the function
+    * with respect to every coefficient. The steps minimize the square error, and are clamped to bounds (the bounds of the coefficients of the genes).
+    * With the LAD and MINMAX error metrics, the steps are taken against the gradient of the error metric (errorGradient) instead.
+    * A step is only accepted if it improves the fitness of chrom with the error metric used, so the result is never worse than chrom.
+    * At most max_evals evaluations of the function on the data points are made, counting the evaluation of the derivatives as one.
+    */
+    std::vector<Gene> refineCoeffs(const std::vector<Gene>& chrom, const std::vector<std::pair<double, double>>& bounds, size_t max_evals) const;
+
+    /*
+    * Returns the gradient of the error metric of chrom with respect to the coefficients of its genes, evaluated together with the function
+    * in a single pass over the data points. The derivative with respect to the j-th coefficient of the k-th gene is at index k*5 + j.
+    * With MINMAX, it is the gradient of the error at the point with the largest error. The elements are NaN if the function is undefined at some points.
+    */
+    std::vector<double> errorGradient(const std::vector<Gene>& chrom) const;
+
+    /*
+    * Returns the sensitivity of the function represented by chrom to each coefficient of its genes: the root mean square of the partial derivative
+    * of the function with respect to the coefficient over the data points, in the same order as the gradient. It is 0 for the unused coefficients.
+    */
+    std::vector<double> sensitivities(const std::vector<Gene>& chrom) const;
+
 private:
 
-    std::vector<double> x_;             /* The data points at which to evaluate the chromosomes. */
-    std::vector<double> fx_desired_;    /* The value of the data points at each x. */
+    std::shared_ptr<const Dataset> data_;   /* The data points at which to evaluate the chromosomes. */
+    const double* x_;                       /* The x values of the data points (owned by data_). */
+    const double* fx_desired_;              /* The value of the data points at each x (owned by data_). */
+    const double* weights_;                 /* The weights of the data points (owned by data_), nullptr if they are not weighted. */
+    size_t num_points_;                     /* The number of data points. */
+    double total_weight_;                   /* The sum of the weights of the data points (the number of points if they are not weighted). */
     Objective error_metric_;            /* The error metric used in the fitness function. */
+    Decoder::Precision precision_ = Decoder::Precision::exact; /* The precision used for evaluating the base functions. */
+
+    /* The cached values of the base function terms. The cache is shared between the copies of the fitness function. */
+    std::shared_ptr<TermCache> term_cache_ = std::make_shared<TermCache>();
+
+    /* The records of the evaluated chromosomes used by the incremental evaluation. They are shared between the copies of the fitness function. */
+    std::shared_ptr<TermRecords> term_records_ = std::make_shared<TermRecords>();
+
+    double x_min_;      /* The lowest x of the data points. */
+    double x_max_;      /* The highest x of the data points. */
+    bool x_sorted_;     /* True if the data points are in ascending order of x (the files of measurements usually are). */
+
+    /* The highest absolute value of the exponents of the poly genes in the chromosomes evaluated from the moments of the data. */
+    static constexpr int max_moment_power = 4;
+
+    /*
+    * The means of x^k and x^k*y over the data points for every k in [-2*max_moment_power, 2*max_moment_power] (at index k + 2*max_moment_power),
+    * and the mean of y^2. The moments of the negative powers are not finite if some of the x values are 0.
+    * The abs moments are the means of |x^k| and |x^k*y|, the rounding error of each moment is at most moment_rounding_ times its abs moment.
+    */
+    std::array<double, 4 * max_moment_power + 1> x_moments_;
+    std::array<double, 4 * max_moment_power + 1> xy_moments_;
+    double y2_moment_;
+    std::array<double, 4 * max_moment_power + 1> x_abs_moments_;
+    std::array<double, 4 * max_moment_power + 1> xy_abs_moments_;
+    double moment_rounding_;
+
+    /* Counters of the chromosomes undefined at some of the data points. They are shared between the copies of the fitness function. */
+    struct NanCounters
+    {
+        std::array<std::atomic<size_t>, Decoder::num_base_funcs()> rejected_funcs{};
+        std::atomic<size_t> rejected = 0;
+        std::atomic<size_t> undefined = 0;
+    };
+    std::shared_ptr<NanCounters> nan_counters_ = std::make_shared<NanCounters>();
+
+    /* A stratified sample of the data points used by evaluateSample. */
+    struct Sample
+    {
+        std::vector<double> x;
+        std::vector<double> fx_desired;
+        std::vector<double> weights;    /* Empty if the data points are not weighted. */
+        double total_weight;
+    };
+
+    /* The samples created by evaluateSample, one for each sample size used. They are shared between the copies of the fitness function. */
+    struct Samples
+    {
+        std::mutex lock;
+        std::vector<std::shared_ptr<const Sample>> samples;
+    };
+    std::shared_ptr<Samples> samples_ = std::make_shared<Samples>();
+
+    /* The number of data points evaluated together before accumulating the error metric over them. */
+    static constexpr size_t block_size = 256;
+
+    /* The min number of data points used when evaluating a chromosome on a sample of the data. */
+    static constexpr size_t min_sample_size = 32;
+
+    /* Returns the sample of the data points containing sample_size points, creating it if it wasn't used before. */
+    std::shared_ptr<const Sample> sampleOf(size_t sample_size) const;
+
+    /* An operand term of a program missing from the term cache. Its values are evaluated over the same blocks of the data points as the program. */
+    struct NewTerm
+    {
+        const Instruction* operand;
+        std::vector<double> values;
+    };
+
+    /*
+    * Get the values of the operand terms of program at every data point from the term cache. The values of the k-th operand of the program
+    * are pointed to by values[k], and the cached ones are kept alive by terms[k]. The values of the missing terms are allocated in new_terms,
+    * but they are not evaluated.
+    */
+    void lookupTerms(const Program& program, std::vector<TermCache::term_t>& terms, std::vector<const double*>& values, std::vector<NewTerm>& new_terms) const;
+
+    /* Evaluate the new terms at the len data points starting at first. */
+    void evalNewTerms(std::vector<NewTerm>& new_terms, size_t first, size_t len) const;
+
+    /* Add the new terms to the term cache once they are evaluated at every data point, and clear new_terms. */
+    void storeNewTerms(std::vector<NewTerm>& new_terms) const;
+
+    /*
+    * Add the errors of the len function values fx_actual compared to fx_desired to the error metric, with weights being the weights of the points
+    * (nullptr if they are not weighted), total_weight the total weight of every data point evaluated, and first_block being true for the first
+    * block of points. Returns the updated error.
+    */
+    double accumulateError(const double* fx_actual, const double* fx_desired, const double* weights, size_t len, double total_weight, bool first_block, double error) const;
+
+    /*
+    * Evaluate the function represented by program and its derivatives with respect to the coefficients over consecutive blocks of the data points,
+    * calling f(first, len, fx, jacobian) for each block, where fx are the values of the function at the len points starting at first, and jacobian the derivatives.
+    */
+    template<typename F>
+    void forEachJacobianBlock(const Program& program, F&& f) const;
+
+    /*
+    * Calc the fitness of chrom the same way as the fitness function call, but without the term cache, so the trial coefficients
+    * of the refinement don't evict the terms of the population.
+    */
+    double trialFitness(const std::vector<Gene>& chrom) const;
+
+    /*
+    * Refine the coefficients of chrom (with fitness fitness) by steps against the gradient of the error metric, with the step length adapted
+    * after each step, using at most max_evals evaluations. Used by refineCoeffs for the error metrics that are not sums of squares.
+    */
+    std::vector<Gene> descendCoeffs(const std::vector<Gene>& chrom, double fitness, const std::vector<std::pair<double, double>>& bounds, size_t max_evals) const;
+
+    /* A term of the function of a chromosome separated by the + and - operators, used by fitLinearCoeffs. */
+    struct LinearTerm
+    {
+        static constexpr size_t npos = size_t(-1);
+
+        size_t first;       /* The index of the first gene of the term. */
+        size_t last;        /* The index of the last gene of the term. */
+        double sign;        /* The sign of the term in the function. */
+        size_t column;      /* The column of the term in the least squares problem, npos if the term is fixed. */
+    };
+
+    /*
+    * Split chrom into its terms, and fill the column-major design matrix A of the least squares problem of fitLinearCoeffs and its right hand side b
+    * (fx_desired minus the fixed terms), with the rows scaled by the square roots of the weights of the points. Returns the current coefficients
+    * of the columns of A (empty if there are no columns).
+    */
+    std::vector<double> linearDesignMatrix(const std::vector<Gene>& chrom, std::vector<LinearTerm>& terms, std::vector<double>& A, std::vector<double>& b) const;
+
+    /* Solve the least squares problem of A with num_columns columns and b, starting from solution. Returns false if it couldn't be solved. */
+    bool solveLinearCoeffs(const std::vector<double>& A, const std::vector<double>& b, size_t num_columns, std::vector<double>& solution) const;
+
+    /*
+    * Write the solution of the least squares problem into the genes of the terms in chrom, clamped to bounds. The coefficients of the columns
+    * after clamping are written to used. Returns true if any of the coefficients had to be clamped.
+    */
+    static bool writeLinearCoeffs(const std::vector<LinearTerm>& terms, const std::vector<double>& solution, const std::vector<std::pair<double, double>>& bounds,
+                                  std::vector<Gene>& chrom, std::vector<double>& used);
+
+    /* Calc the fitness value from the error accumulated over every data point. */
+    double errorToFitness(double error) const;
+
+    /*
+    * Returns true if the function represented by program is certainly undefined at some of the data points, so its fitness is 0 without evaluating it.
+    * If everywhere is true, it must be undefined at every data point. The rejected programs are added to the counters.
+    */
+    bool isUndefined(const Program& program, bool everywhere) const;
+
+    /*
+    * Calculate the mean square error of chrom from the moments of the data points if it represents a polynomial: it only contains c, lin, and poly
+    * genes with integer exponents of at most max_moment_power in absolute value, joined by the + and - operators. The error is calculated in
+    * O(chrom.size()^2) time regardless of the number of data points, and it is written to error.
+    * Returns false if chrom is not of this form, the error metric is not LS or RMSE, or the bound of the relative rounding error of the result is
+    * above 1E-8 (because the error is much smaller than the terms it is calculated from), so chrom has to be evaluated at the data points instead.
+    */
+    bool momentSquareError(const std::vector<Gene>& chrom, double& error) const;
+
+    /* Find the range of the x values of the data points, and whether they are sorted, or take them from the summary of the dataset. */
+    void updateRange();
+
+    /* Calculate the moments of the data points used by momentSquareError, using compensated summation. */
+    void updateMoments();
 
-    /* Objective functions/error metrics. */
+    /*
+    * Objective functions/error metrics.
+    * They are accumulated over consecutive blocks of the data points, with len being the number of points in the current block, weights the
+    * weights of these points (nullptr if they are not weighted), and total_weight the total weight of the data points (their number if they are
+    * not weighted). Each function returns the updated value of the metric.
+    */
 
-    static double squareErrorMean(const std::vector<double>& fx_actual, const std::vector<double>& fx_desired);
-    static double absoluteErrorMean(const std::vector<double>& fx_actual, const std::vector<double>& fx_desired);
-    static double rootMeanSquareError(const std::vector<double>& fx_actual, const std::vector<double>& fx_desired);
-    static double maximumError(const std::vector<double>& fx_actual, const std::vector<double>& fx_desired);
+    static double squareErrorMean(const double* fx_actual, const double* fx_desired, const double* weights, size_t len, double total_weight, double mean);
+    static double absoluteErrorMean(const double* fx_actual, const double* fx_desired, const double* weights, size_t len, double total_weight, double mean);
+    static double maximumError(const double* fx_actual, const double* fx_desired, size_t len, double error_max);
 };
 
 #endif // !FITNESS_FUNCTION_H
\ No newline at end of file
@@ -0,0 +1,117 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+#include "least_squares.h"
+
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
+
+
+bool LeastSquares::solve(std::vector<double>& A, size_t rows, size_t cols, std::vector<double>& b, std::vector<double>& coeffs)
+{
+    assert(A.size() == rows * cols);
+    assert(b.size() == rows);
+    assert(coeffs.size() == cols);
+
+    if (!std::all_of(A.begin(), A.end(), [](double v) { return std::isfinite(v); }) ||
+        !std::all_of(b.begin(), b.end(), [](double v) { return std::isfinite(v); }))
+    {
+        return false;
+    }
+
+    /*
+    * Triangularize A with Householder reflections, applying them to b too. The reflection of the k-th independent column zeroes its
+    * elements below row k, so the upper triangular R is stored in the first rank rows of the independent columns.
+    */
+    std::vector<double> diagonal(cols);   /* The diagonal elements of R. */
+    std::vector<bool> dependent(cols, true);
+    size_t rank = 0;
+
+    for (size_t j = 0; j < cols; j++)
+    {
+        double* col = A.data() + j * rows;
+
+        /* The norm of the part of the column below the rows of R, and the norm of the whole column (not changed by the reflections). */
+        double sub_norm_sq = dot(col + rank, col + rank, rows - rank);
+        double sub_norm = std::sqrt(sub_norm_sq);
+        double norm = std::sqrt(sub_norm_sq + dot(col, col, rank));
+
+        /*
+        * The column is (almost) in the span of the previous independent columns. The reflections are linear, so subtracting the
+        * reflected column times its fixed coefficient from the reflected b is the same as subtracting it from b before the reflections.
+        */
+        if (sub_norm <= tolerance * norm)
+        {
+            for (size_t i = 0; i < rows; i++)
+            {
+                b[i] -= coeffs[j] * col[i];
+            }
+            continue;
+        }
+
+        dependent[j] = false;
+
+        /* The Householder vector v is stored in place of the column, the reflection is I - 2*v*v^T/(v^T*v). */
+        double alpha = (col[rank] > 0.0) ? -sub_norm : sub_norm;
+        double v_norm_sq = 2.0 * sub_norm * (sub_norm + std::abs(col[rank]));
+        col[rank] -= alpha;
+
+        auto reflect = [&](double* target)
+        {
+            double scale = 2.0 * dot(col + rank, target + rank, rows - rank) / v_norm_sq;
+            for (size_t i = rank; i < rows; i++)
+            {
+                target[i] -= scale * col[i];
+            }
+        };
+        for (size_t k = j + 1; k < cols; k++)
+        {
+            reflect(A.data() + k * rows);
+        }
+        reflect(b.data());
+
+        diagonal[j] = alpha;
+        rank++;
+    }
+
+    /* Back substitution, R*coeffs = Q^T*b using the independent columns. */
+    size_t row = rank;
+    for (size_t j = cols; j-- > 0;)
+    {
+        if (dependent[j]) continue;
+        row--;
+
+        /* The dependent columns are already subtracted from b. */
+        double sum = b[row];
+        for (size_t k = j + 1; k < cols; k++)
+        {
+            if (!dependent[k]) sum -= A[k * rows + row] * coeffs[k];
+        }
+        coeffs[j] = sum / diagonal[j];
+    }
+
+    return true;
+}
+
+double LeastSquares::dot(const double* lhs, const double* rhs, size_t n) noexcept
+{
+    /* Use independent partial sums, so the additions don't have to wait for each other. */
+    double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        sum[0] += lhs[i] * rhs[i];
+        sum[1] += lhs[i + 1] * rhs[i + 1];
+        sum[2] += lhs[i + 2] * rhs[i + 2];
+        sum[3] += lhs[i + 3] * rhs[i + 3];
+    }
+    for (; i < n; i++)
+    {
+        sum[0] += lhs[i] * rhs[i];
+    }
+
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
\ No newline at end of file
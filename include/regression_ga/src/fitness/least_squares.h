@@ -0,0 +1,37 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/* Dense linear least squares solver used for fitting the coefficients of the candidates. */
+
+#ifndef LEAST_SQUARES_H
+#define LEAST_SQUARES_H
+
+#include <vector>
+#include <cstddef>
+
+
+/*
+* Solves small dense linear least squares problems using the Householder QR decomposition.
+* The problems have many more rows (data points) than columns (terms), so the matrices are stored column by column.
+*/
+class LeastSquares
+{
+public:
+
+    /*
+    * Find the coefficients minimizing ||A*coeffs - b||, where A is a rows x cols matrix stored column by column. A and b are overwritten.
+    * The columns that are linearly dependent on the previous columns (within a relative tolerance) keep the coefficients they have in
+    * coeffs on input, and the coefficients of the other columns are set to the values minimizing the error with these fixed.
+    * Returns false without changing coeffs if A or b contain values that are not finite.
+    */
+    static bool solve(std::vector<double>& A, size_t rows, size_t cols, std::vector<double>& b, std::vector<double>& coeffs);
+
+private:
+
+    /* The dot product of the n element vectors lhs and rhs. */
+    static double dot(const double* lhs, const double* rhs, size_t n) noexcept;
+
+    /* Columns whose norm is reduced below this fraction of their original norm by the previous reflections are considered linearly dependent. */
+    static constexpr double tolerance = 1E-10;
+};
+
+#endif // !LEAST_SQUARES_H
\ No newline at end of file
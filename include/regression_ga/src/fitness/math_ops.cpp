@@ -2,8 +2,8 @@
 
 #include "math_ops.h"
 
-#include <vector>
 #include <cmath>
+#include <cstddef>
 #include <cassert>
 #include <cstdlib>
 
@@ -28,85 +28,65 @@ int precedent(int op)
 	}
 }
 
-std::vector<double> operator+(const std::vector<double>& lhs, const std::vector<double>& rhs)
+void vecAdd(double* lhs, const double* rhs, size_t n)
 {
-	assert(lhs.size() == rhs.size());
-
-	std::vector<double> result(lhs.size());
-	for (size_t i = 0; i < lhs.size(); i++)
+	for (size_t i = 0; i < n; i++)
 	{
-		result[i] = lhs[i] + rhs[i];
+		lhs[i] = lhs[i] + rhs[i];
 	}
-
-	return result;
 }
 
-std::vector<double> operator-(const std::vector<double>& lhs, const std::vector<double>& rhs)
+void vecSub(double* lhs, const double* rhs, size_t n)
 {
-	assert(lhs.size() == rhs.size());
-
-	std::vector<double> result(lhs.size());
-	for (size_t i = 0; i < lhs.size(); i++)
+	for (size_t i = 0; i < n; i++)
 	{
-		result[i] = lhs[i] - rhs[i];
+		lhs[i] = lhs[i] - rhs[i];
 	}
-
-	return result;
 }
 
-std::vector<double> operator*(const std::vector<double>& lhs, const std::vector<double>& rhs)
+void vecMul(double* lhs, const double* rhs, size_t n)
 {
-	assert(lhs.size() == rhs.size());
-
-	std::vector<double> result(lhs.size());
-	for (size_t i = 0; i < lhs.size(); i++)
+	for (size_t i = 0; i < n; i++)
 	{
-		result[i] = lhs[i] * rhs[i];
+		lhs[i] = lhs[i] * rhs[i];
 	}
-
-	return result;
 }
 
-std::vector<double> operator/(const std::vector<double>& lhs, const std::vector<double>& rhs)
+void vecDiv(double* lhs, const double* rhs, size_t n)
 {
-	assert(lhs.size() == rhs.size());
-
-	std::vector<double> result(lhs.size());
-	for (size_t i = 0; i < lhs.size(); i++)
+	for (size_t i = 0; i < n; i++)
 	{
-		result[i] = lhs[i] / rhs[i];
+		lhs[i] = lhs[i] / rhs[i];
 	}
-
-	return result;
 }
 
-std::vector<double> operator^(const std::vector<double>& lhs, const std::vector<double>& rhs)
+void vecPow(double* lhs, const double* rhs, size_t n)
 {
-	assert(lhs.size() == rhs.size());
-
-	std::vector<double> result(lhs.size());
-	for (size_t i = 0; i < lhs.size(); i++)
+	for (size_t i = 0; i < n; i++)
 	{
-		result[i] = std::pow(lhs[i], rhs[i]);
+		lhs[i] = std::pow(lhs[i], rhs[i]);
 	}
-
-	return result;
 }
 
-std::vector<double> performOperation(const std::vector<double>& lhs, const std::vector<double>& rhs, int op)
+void performOperation(double* lhs, const double* rhs, size_t n, int op)
 {
 	switch (op)
 	{
 		case OP_ADD:
-			return lhs + rhs;
+			vecAdd(lhs, rhs, n);
+			break;
 		case OP_SUB:
-			return lhs - rhs;
+			vecSub(lhs, rhs, n);
+			break;
 		case OP_MUL:
-			return lhs * rhs;
+			vecMul(lhs, rhs, n);
+			break;
 		case OP_DIV:
-			return lhs / rhs;
+			vecDiv(lhs, rhs, n);
+			break;
 		case OP_POW:
-			return lhs ^ rhs;
+			vecPow(lhs, rhs, n);
+			break;
 		default:
 			assert(false);	/* Invalid operator. Shouldn't get here. */
 			std::abort();
@@ -5,7 +5,7 @@
 #ifndef FITNESS_UTILS_H
 #define FITNESS_UTILS_H
 
-#include <vector>
+#include <cstddef>
 
 
 /* Codes for the different math operators used in the fitted math functions. */
@@ -22,14 +22,14 @@ constexpr int _NUM_OPS = _OP_MAX - _OP_MIN + 1;
 /* Return the precedent of a math operator. */
 int precedent(int op);
 
-/* Math operators for double vectors (of equal size). */
-std::vector<double> operator+(const std::vector<double>& lhs, const std::vector<double>& rhs);
-std::vector<double> operator-(const std::vector<double>& lhs, const std::vector<double>& rhs);
-std::vector<double> operator*(const std::vector<double>& lhs, const std::vector<double>& rhs);
-std::vector<double> operator/(const std::vector<double>& lhs, const std::vector<double>& rhs);
-std::vector<double> operator^(const std::vector<double>& lhs, const std::vector<double>& rhs);
+/* In-place math operators for double arrays of size n (lhs = lhs op rhs). */
+void vecAdd(double* lhs, const double* rhs, size_t n);
+void vecSub(double* lhs, const double* rhs, size_t n);
+void vecMul(double* lhs, const double* rhs, size_t n);
+void vecDiv(double* lhs, const double* rhs, size_t n);
+void vecPow(double* lhs, const double* rhs, size_t n);
 
-/* Perform the math operation op on the 2 double vectors lhs and rhs. */
-std::vector<double> performOperation(const std::vector<double>& lhs, const std::vector<double>& rhs, int op);
+/* Perform the math operation op on the 2 double arrays lhs and rhs of size n, storing the results in lhs. */
+void performOperation(double* lhs, const double* rhs, size_t n, int op);
 
 #endif // !FITNESS_UTILS_H
\ No newline at end of file
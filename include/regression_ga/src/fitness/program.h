@@ -0,0 +1,38 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/*
+* Compiled form of the math functions encoded by the chromosomes.
+* A program is a flat postfix sequence of instructions that can be evaluated directly, without building any intermediate expressions.
+*/
+
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include "../genetic/gene.h"
+
+#include <vector>
+#include <cstddef>
+
+
+/* A single instruction of a program. It is either an operator or an operand (a base function with its coefficients). */
+struct Instruction
+{
+    /* Operator or operand. */
+    bool is_operator;
+
+    /* Operand. */
+    int fid;
+    coeffs_t coeffs;
+
+    /* Operator. */
+    int opid;
+};
+
+/* A compiled postfix expression. */
+struct Program
+{
+    std::vector<Instruction> code;  /* The instructions of the expression in postfix order. */
+    size_t max_depth = 0;           /* The maximum size of the operand stack while evaluating the program. */
+};
+
+#endif // !PROGRAM_H
\ No newline at end of file
@@ -0,0 +1,165 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+#include "simplifier.h"
+#include "decoder.h"
+#include "program.h"
+#include "math_ops.h"
+#include "../genetic/gene.h"
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
+
+
+std::vector<Gene> Simplifier::simplify(const std::vector<Gene>& chrom, Decoder::Precision precision)
+{
+    std::vector<Gene> simplified;
+    simplify(chrom, simplified, precision);
+
+    return simplified;
+}
+
+void Simplifier::simplify(const std::vector<Gene>& chrom, std::vector<Gene>& simplified, Decoder::Precision precision)
+{
+    assert(chrom.size() > 0);
+
+    simplified.assign(chrom.begin(), chrom.end());
+
+    for (auto& gene : simplified)
+    {
+        simplifyOperand(gene, precision);
+    }
+
+    /* Every simplification removes at least 1 gene, so this terminates. */
+    for (size_t idx = 0; idx + 1 < simplified.size(); )
+    {
+        if (simplifyOperator(simplified, idx, precision))
+        {
+            /* The operation of the previous operator may have become simpler too. */
+            idx = (idx > 0) ? idx - 1 : 0;
+        }
+        else
+        {
+            idx++;
+        }
+    }
+}
+
+void Simplifier::simplifyOperand(Gene& gene, Decoder::Precision precision)
+{
+    if (gene.fid == 0) return;
+
+    if (isConstant(gene))
+    {
+        /* Evaluate the function the same way the decoder would, so the value is exactly the same as the value at the data points. */
+        Instruction operand;
+        operand.is_operator = false;
+        operand.fid = gene.fid;
+        operand.opid = _OP_MIN;
+        operand.coeffs = gene.coeffs;
+
+        double x = 0.0, fx;
+        Decoder::evalOperand(operand, &x, &fx, 1, precision);
+
+        gene = constant(fx, gene.opid);
+    }
+    /* a*x^1 + d = a*x + d */
+    else if (gene.fid == 2 && gene.coeffs[4] == 1.0)
+    {
+        gene.fid = 1;
+    }
+}
+
+bool Simplifier::simplifyOperator(std::vector<Gene>& expr, size_t idx, Decoder::Precision precision)
+{
+    assert(idx + 1 < expr.size());
+
+    const int op = expr[idx].opid;
+
+    /*
+    * Find the operands of the operator. The operators are left associative, so the left operand contains the preceding
+    * operators with at least the same precedent, while the right operand contains the following operators with higher precedents.
+    */
+    size_t first = idx;
+    while (first > 0 && precedent(expr[first - 1].opid) >= precedent(op)) first--;
+
+    size_t last = idx + 1;
+    while (last + 1 < expr.size() && precedent(expr[last].opid) > precedent(op)) last++;
+
+    const bool lhs_const = (first == idx) && (expr[idx].fid == 0);
+    const bool rhs_const = (last == idx + 1) && (expr[idx + 1].fid == 0);
+
+    const double lhs = expr[idx].coeffs[2];
+    const double rhs = expr[idx + 1].coeffs[2];
+
+    /* Both operands are constants. */
+    if (lhs_const && rhs_const)
+    {
+        Instruction instruction;
+        instruction.is_operator = true;
+        instruction.fid = 0;
+        instruction.opid = op;
+
+        double value = lhs;
+        Decoder::evalOperator(instruction, &value, &rhs, 1, precision);
+
+        expr[idx] = constant(value, expr[idx + 1].opid);
+        expr.erase(expr.begin() + idx + 1);
+
+        return true;
+    }
+    /* f^0 = 1 and 1^f = 1, even if f is undefined. */
+    if (op == OP_POW && ((rhs_const && rhs == 0.0) || (lhs_const && lhs == 1.0)))
+    {
+        expr[first] = constant(1.0, expr[last].opid);
+        expr.erase(expr.begin() + first + 1, expr.begin() + last + 1);
+
+        return true;
+    }
+    /* f*1 = f/1 = f^1 = f - 0 = f. (f + 0 and f - (-0) are not always f, since -0.0 + 0.0 = 0.0.) */
+    if (rhs_const && ((rhs == 1.0 && (op == OP_MUL || op == OP_DIV || op == OP_POW)) || (rhs == 0.0 && !std::signbit(rhs) && op == OP_SUB)))
+    {
+        expr[idx].opid = expr[idx + 1].opid;
+        expr.erase(expr.begin() + idx + 1);
+
+        return true;
+    }
+    /* 1*f = f */
+    if (lhs_const && lhs == 1.0 && op == OP_MUL)
+    {
+        expr.erase(expr.begin() + idx);
+
+        return true;
+    }
+
+    return false;
+}
+
+bool Simplifier::isConstant(const Gene& gene) noexcept
+{
+    const auto& [a, b, c, d, n] = gene.coeffs;
+
+    switch (gene.fid)
+    {
+        /* c */
+        case 0:
+            return true;
+        /* poly: x^0 = 1 everywhere. */
+        case 2:
+            return n == 0.0;
+        /* lin, sgn, cos, arctan: these are finite at finite points, so multiplying them by 0 gives +-0, and adding d != 0 gives exactly d. */
+        case 1: case 8: case 9: case 11:
+            return a == 0.0 && d != 0.0;
+        /* rec, root, exp, log, arcsin, arcsec, arsinh, arcosh, arctgh, arsech, arcsch: the argument b*x + c is exactly c if b == 0 and c != 0. */
+        case 3: case 4: case 5: case 6: case 10: case 12: case 13: case 14: case 16: case 17: case 18:
+            return b == 0.0 && c != 0.0;
+        default:
+            return false;
+    }
+}
+
+Gene Simplifier::constant(double c, int opid) noexcept
+{
+    return Gene(0, { 0.0, 0.0, c, 0.0, 0.0 }, opid);
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/*
+* Simplification of the math functions encoded by the chromosomes before they are evaluated or printed.
+* Only the transformations that don't change the value of the function at any finite point are applied.
+*/
+
+#ifndef SIMPLIFIER_H
+#define SIMPLIFIER_H
+
+#include "decoder.h"
+#include "../genetic/gene.h"
+
+#include <vector>
+#include <cstddef>
+
+
+/*
+* Simplifies the chromosomes by folding their data independent parts into constant genes, and
+* removing the operations that don't change their operand (eg. multiplication by 1, or x^1).
+* The simplified chromosome represents the same function, but may contain fewer genes, and can't be used in the GA.
+*/
+class Simplifier
+{
+public:
+
+    /* Return the simplified form of chrom, with the constants computed using the given precision. */
+    static std::vector<Gene> simplify(const std::vector<Gene>& chrom, Decoder::Precision precision = Decoder::Precision::exact);
+
+    /* Simplify chrom into an existing chromosome, reusing its storage. */
+    static void simplify(const std::vector<Gene>& chrom, std::vector<Gene>& simplified, Decoder::Precision precision = Decoder::Precision::exact);
+
+private:
+
+    /* Replace the gene with a constant gene if the value of its base function doesn't depend on x, or with a cheaper base function if it has one. */
+    static void simplifyOperand(Gene& gene, Decoder::Precision precision);
+
+    /* Simplify the operation of the operator of the idx-th gene. Returns true if the expression was changed. */
+    static bool simplifyOperator(std::vector<Gene>& expr, size_t idx, Decoder::Precision precision);
+
+    /* Return true if the value of the base function of the gene is the same at every finite x. */
+    static bool isConstant(const Gene& gene) noexcept;
+
+    /* Return a constant gene with the value c, followed by the operator opid. */
+    static Gene constant(double c, int opid) noexcept;
+};
+
+#endif // !SIMPLIFIER_H
\ No newline at end of file
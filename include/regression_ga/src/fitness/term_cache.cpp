@@ -0,0 +1,178 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+#include "term_cache.h"
+#include "../genetic/gene.h"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+/* Constructors. */
+
+TermCache::TermCache(size_t max_bytes)
+{
+    this->max_bytes(max_bytes);
+}
+
+/* Setters. */
+
+void TermCache::max_bytes(size_t max_bytes)
+{
+    clear();
+    max_bytes_ = max_bytes;
+}
+
+/* Getters. */
+
+size_t TermCache::max_bytes() const noexcept
+{
+    return max_bytes_;
+}
+
+bool TermCache::enabled() const noexcept
+{
+    return max_bytes_ != 0;
+}
+
+size_t TermCache::size() const
+{
+    size_t size = 0;
+    for (const auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        size += shard.recent.size() + shard.old.size();
+    }
+
+    return size;
+}
+
+size_t TermCache::hits() const noexcept
+{
+    return static_cast<size_t>(hits_);
+}
+
+size_t TermCache::misses() const noexcept
+{
+    return static_cast<size_t>(misses_);
+}
+
+/* Cache operations. */
+
+TermCache::term_t TermCache::find(int fid, const coeffs_t& coeffs)
+{
+    Key key{ fid, coeffs };
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    if (auto it = shard.recent.find(key); it != shard.recent.end())
+    {
+        hits_++;
+        return it->second;
+    }
+    if (auto it = shard.old.find(key); it != shard.old.end())
+    {
+        hits_++;
+
+        /* Move the term to the recent generation, so it isn't evicted with the old generation. */
+        auto node = shard.old.extract(it);
+        term_t term = node.mapped();
+        size_t bytes = entryBytes(term->size());
+
+        makeRoom(shard, bytes);
+        shard.recent.insert(std::move(node));
+        shard.recent_bytes += bytes;
+
+        return term;
+    }
+
+    misses_++;
+    return nullptr;
+}
+
+TermCache::term_t TermCache::insert(int fid, const coeffs_t& coeffs, std::vector<double>&& values)
+{
+    Key key{ fid, coeffs };
+    size_t bytes = entryBytes(values.size());
+    term_t term = std::make_shared<const std::vector<double>>(std::move(values));
+
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    /* Another thread could have added the same term since it was looked up. */
+    if (auto it = shard.recent.find(key); it != shard.recent.end()) return it->second;
+    if (auto it = shard.old.find(key); it != shard.old.end()) return it->second;
+
+    makeRoom(shard, bytes);
+    shard.recent.emplace(key, term);
+    shard.recent_bytes += bytes;
+
+    return term;
+}
+
+void TermCache::clear()
+{
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        shard.recent.clear();
+        shard.old.clear();
+        shard.recent_bytes = 0;
+    }
+    hits_ = 0;
+    misses_ = 0;
+}
+
+TermCache::Shard& TermCache::shardOf(const Key& key) noexcept
+{
+    /* The hash is mixed before selecting the shard, as the same hash bits are also used by the unordered_maps. */
+    uint64_t hash = static_cast<uint64_t>(KeyHasher()(key)) * 0x9e3779b97f4a7c15;
+
+    return shards_[(hash >> 32) % num_shards];
+}
+
+size_t TermCache::entryBytes(size_t num_values) noexcept
+{
+    /* The values, the vector and its control block, and the node of the map (estimated). */
+    return num_values * sizeof(double) + sizeof(std::vector<double>) + sizeof(Key) + 64;
+}
+
+void TermCache::makeRoom(Shard& shard, size_t bytes)
+{
+    /* Each generation of a shard can use an equal part of half of the memory limit, but it can always store at least 1 term. */
+    size_t generation_bytes = max_bytes_ / (2 * num_shards);
+
+    if (!shard.recent.empty() && shard.recent_bytes + bytes > generation_bytes)
+    {
+        shard.old = std::move(shard.recent);
+        shard.recent.clear();
+        shard.recent_bytes = 0;
+    }
+}
+
+/* Keys. */
+
+bool TermCache::Key::operator==(const Key& rhs) const noexcept
+{
+    if (fid != rhs.fid) return false;
+
+    for (size_t i = 0; i < coeffs.size(); i++)
+    {
+        if (std::bit_cast<uint64_t>(coeffs[i]) != std::bit_cast<uint64_t>(rhs.coeffs[i])) return false;
+    }
+    return true;
+}
+
+size_t TermCache::KeyHasher::operator()(const Key& key) const noexcept
+{
+    size_t seed = std::hash<int>()(key.fid);
+    for (const auto& coeff : key.coeffs)
+    {
+        seed ^= std::hash<uint64_t>()(std::bit_cast<uint64_t>(coeff)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    return seed;
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/*
+* Cache for the values of the base function terms of the genes at the data points of the fitness function.
+* The same gene (function id and coefficients) often appears in several candidates of a population, and the children
+* mostly contain genes that are identical to the genes of their parents, so each distinct term only has to be evaluated once,
+* and the other candidates containing it can use the cached values.
+*/
+
+#ifndef TERM_CACHE_H
+#define TERM_CACHE_H
+
+#include "../genetic/gene.h"
+
+#include <vector>
+#include <unordered_map>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+
+
+/*
+* Thread-safe cache mapping base function terms (function id + coefficients) to their values at the data points, limited by its memory usage.
+* The cache is split into shards with separate locks, so the threads evaluating the candidates in parallel rarely have to wait for each other.
+* Each shard stores its entries in 2 generations: new entries are added to the recent generation, and when it is full, the old generation
+* is discarded and replaced by the recent one. Entries found in the old generation are moved back to the recent one.
+*/
+class TermCache
+{
+public:
+
+    /* The values of a term at every data point. They are shared, so evicting a term doesn't invalidate it while it is being used. */
+    using term_t = std::shared_ptr<const std::vector<double>>;
+
+    /* Contructors. A memory limit of 0 disables the cache. */
+    explicit TermCache(size_t max_bytes = 0);
+
+    /* Setters. Changing the memory limit also clears the cache. */
+    void max_bytes(size_t max_bytes);
+
+    /* Getters. */
+    size_t max_bytes() const noexcept;
+    bool enabled() const noexcept;
+    size_t size() const;
+    size_t hits() const noexcept;
+    size_t misses() const noexcept;
+
+    /* Returns the values of the term fid with coeffs coefficients, or nullptr if it isn't in the cache. */
+    term_t find(int fid, const coeffs_t& coeffs);
+
+    /* Add the values of the term fid with coeffs coefficients to the cache. Returns the values stored in the cache. */
+    term_t insert(int fid, const coeffs_t& coeffs, std::vector<double>&& values);
+
+    /* Remove every entry from the cache and reset the hit/miss counters. */
+    void clear();
+
+private:
+
+    struct Key
+    {
+        int fid;
+        coeffs_t coeffs;
+
+        /* The coefficients are compared bitwise, so eg. 0.0 and -0.0 are different keys. */
+        bool operator==(const Key& rhs) const noexcept;
+    };
+
+    struct KeyHasher
+    {
+        size_t operator()(const Key& key) const noexcept;
+    };
+
+    using Map = std::unordered_map<Key, term_t, KeyHasher>;
+
+    struct Shard
+    {
+        mutable std::mutex lock;
+        Map recent;                 /* The terms added or used since the last generation change. */
+        Map old;                    /* The terms of the previous generation. */
+        size_t recent_bytes = 0;    /* The memory used by the terms of the recent generation. */
+    };
+
+    static constexpr size_t num_shards = 16;
+
+    std::array<Shard, num_shards> shards_;
+    size_t max_bytes_ = 0;          /* The max memory used by the terms stored in the cache. */
+
+    std::atomic<size_t> hits_ = 0;
+    std::atomic<size_t> misses_ = 0;
+
+    Shard& shardOf(const Key& key) noexcept;
+
+    /* The approximate memory used by a cache entry with num_values values. */
+    static size_t entryBytes(size_t num_values) noexcept;
+
+    /* Replace the old generation of shard with the recent one if adding an entry of bytes size would make the recent generation too large. */
+    void makeRoom(Shard& shard, size_t bytes);
+};
+
+#endif // !TERM_CACHE_H
\ No newline at end of file
@@ -0,0 +1,163 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+#include "term_records.h"
+#include "../genetic/gene.h"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+
+/* Constructors. */
+
+TermRecords::TermRecords(size_t max_bytes)
+{
+    this->max_bytes(max_bytes);
+}
+
+/* Setters. */
+
+void TermRecords::max_bytes(size_t max_bytes)
+{
+    clear();
+    max_bytes_ = max_bytes;
+}
+
+/* Getters. */
+
+size_t TermRecords::max_bytes() const noexcept
+{
+    return max_bytes_;
+}
+
+bool TermRecords::enabled() const noexcept
+{
+    return max_bytes_ != 0;
+}
+
+size_t TermRecords::hits() const noexcept
+{
+    return static_cast<size_t>(hits_);
+}
+
+size_t TermRecords::misses() const noexcept
+{
+    return static_cast<size_t>(misses_);
+}
+
+/* Cache operations. */
+
+TermRecords::record_t TermRecords::find(const std::vector<Gene>& chrom)
+{
+    Shard& shard = shardOf(ChromosomeHasher()(chrom));
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    if (auto it = shard.recent.find(chrom); it != shard.recent.end())
+    {
+        hits_++;
+        return it->second;
+    }
+    if (auto it = shard.old.find(chrom); it != shard.old.end())
+    {
+        hits_++;
+
+        /* Move the record to the recent generation, so it isn't evicted with the old generation. */
+        auto node = shard.old.extract(it);
+        record_t record = node.mapped();
+        size_t bytes = entryBytes(node.key(), *record);
+
+        makeRoom(shard, bytes);
+        shard.recent.insert(std::move(node));
+        shard.recent_bytes += bytes;
+
+        return record;
+    }
+
+    misses_++;
+    return nullptr;
+}
+
+void TermRecords::insert(const std::vector<Gene>& chrom, record_t record)
+{
+    size_t bytes = entryBytes(chrom, *record);
+
+    Shard& shard = shardOf(ChromosomeHasher()(chrom));
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    /* Another thread could have added the same chromosome since it was looked up. */
+    if (shard.recent.contains(chrom) || shard.old.contains(chrom)) return;
+
+    makeRoom(shard, bytes);
+    shard.recent.emplace(chrom, std::move(record));
+    shard.recent_bytes += bytes;
+}
+
+void TermRecords::clear()
+{
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        shard.recent.clear();
+        shard.old.clear();
+        shard.recent_bytes = 0;
+    }
+    hits_ = 0;
+    misses_ = 0;
+}
+
+TermRecords::Shard& TermRecords::shardOf(size_t hash) noexcept
+{
+    /* The hash is mixed before selecting the shard, as the same hash bits are also used by the unordered_maps. */
+    return shards_[((static_cast<uint64_t>(hash) * 0x9e3779b97f4a7c15) >> 32) % num_shards];
+}
+
+size_t TermRecords::entryBytes(const std::vector<Gene>& chrom, const Record& record) noexcept
+{
+    /* The key, the terms and their values with their control blocks, and the node of the map (estimated). */
+    size_t term_bytes = sizeof(Term) + record.num_points * sizeof(double) + 32;
+
+    return chrom.size() * sizeof(Gene) + sizeof(Record) + record.terms.size() * term_bytes + 64;
+}
+
+void TermRecords::makeRoom(Shard& shard, size_t bytes)
+{
+    /* Each generation of a shard can use an equal part of half of the memory limit, but it can always store at least 1 record. */
+    size_t generation_bytes = max_bytes_ / (2 * num_shards);
+
+    if (!shard.recent.empty() && shard.recent_bytes + bytes > generation_bytes)
+    {
+        shard.old = std::move(shard.recent);
+        shard.recent.clear();
+        shard.recent_bytes = 0;
+    }
+}
+
+/* Terms. */
+
+bool TermRecords::Term::same(int fid, const coeffs_t& coeffs) const noexcept
+{
+    if (this->fid != fid) return false;
+
+    for (size_t i = 0; i < coeffs.size(); i++)
+    {
+        if (std::bit_cast<uint64_t>(this->coeffs[i]) != std::bit_cast<uint64_t>(coeffs[i])) return false;
+    }
+    return true;
+}
+
+/* Keys. */
+
+size_t TermRecords::ChromosomeHasher::operator()(const std::vector<Gene>& chrom) const noexcept
+{
+    size_t seed = chrom.size();
+    for (const auto& gene : chrom)
+    {
+        seed ^= std::hash<Gene>()(gene) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    return seed;
+}
\ No newline at end of file
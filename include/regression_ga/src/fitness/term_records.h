@@ -0,0 +1,106 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/*
+* Records of the evaluated base function terms of the chromosomes, used for evaluating their children incrementally.
+* The children created by the crossovers and mutations usually only differ from one of their parents in a few genes,
+* so most of the base function terms of a child are the same as the terms of that parent, and they don't have to be evaluated again.
+*/
+
+#ifndef TERM_RECORDS_H
+#define TERM_RECORDS_H
+
+#include "../genetic/gene.h"
+
+#include <vector>
+#include <unordered_map>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+
+
+/*
+* Thread-safe cache mapping the chromosomes to the values of the base function terms of their genes at the data points, limited by its memory usage.
+* The cache is split into shards with separate locks, and each shard stores its entries in 2 generations: when the recent generation of a shard
+* is full, it replaces the old one, and the records of the old generation are moved to the recent one when they are used again.
+*/
+class TermRecords
+{
+public:
+
+    /* A base function term of an evaluated chromosome. */
+    struct Term
+    {
+        int fid;
+        coeffs_t coeffs;
+        std::shared_ptr<const double[]> values;     /* The values of the term at every data point, shared with the records of the children. */
+
+        /* Returns true if the term is the base function fid with coeffs coefficients. The coefficients are compared bitwise, eg. 0.0 and -0.0 can give different values. */
+        bool same(int fid, const coeffs_t& coeffs) const noexcept;
+    };
+
+    /* The record of an evaluated chromosome. */
+    struct Record
+    {
+        size_t num_points;          /* The number of values of each term. */
+        std::vector<Term> terms;    /* The terms in the order of the operands of the program of the chromosome. */
+    };
+    using record_t = std::shared_ptr<const Record>;
+
+    /* Contructors. A memory limit of 0 disables the cache. */
+    explicit TermRecords(size_t max_bytes = 0);
+
+    /* Setters. Changing the memory limit also clears the cache. */
+    void max_bytes(size_t max_bytes);
+
+    /* Getters. */
+    size_t max_bytes() const noexcept;
+    bool enabled() const noexcept;
+    size_t hits() const noexcept;
+    size_t misses() const noexcept;
+
+    /* Returns the record of chrom, or nullptr if it isn't in the cache. */
+    record_t find(const std::vector<Gene>& chrom);
+
+    /* Add the record of chrom to the cache. */
+    void insert(const std::vector<Gene>& chrom, record_t record);
+
+    /* Remove every entry from the cache and reset the hit/miss counters. */
+    void clear();
+
+private:
+
+    struct ChromosomeHasher
+    {
+        size_t operator()(const std::vector<Gene>& chrom) const noexcept;
+    };
+
+    using Map = std::unordered_map<std::vector<Gene>, record_t, ChromosomeHasher>;
+
+    struct Shard
+    {
+        std::mutex lock;
+        Map recent;                 /* The records added or used since the last generation change. */
+        Map old;                    /* The records of the previous generation. */
+        size_t recent_bytes = 0;    /* The memory used by the records of the recent generation. */
+    };
+
+    static constexpr size_t num_shards = 16;
+
+    std::array<Shard, num_shards> shards_;
+    size_t max_bytes_ = 0;          /* The max memory used by the records stored in the cache. */
+
+    std::atomic<size_t> hits_ = 0;
+    std::atomic<size_t> misses_ = 0;
+
+    Shard& shardOf(size_t hash) noexcept;
+
+    /* The approximate memory used by a cache entry. The values shared by several records are counted for each of them. */
+    static size_t entryBytes(const std::vector<Gene>& chrom, const Record& record) noexcept;
+
+    /* Replace the old generation of shard with the recent one if adding an entry of bytes size would make the recent generation too large. */
+    void makeRoom(Shard& shard, size_t bytes);
+};
+
+#endif // !TERM_RECORDS_H
\ No newline at end of file
@@ -6,8 +6,7 @@
 #define TOKEN_H_
 
 #include "math_ops.h"
-
-#include <vector>
+#include "../genetic/gene.h"
 
 
 /* A token used in the postfix and infix expressions. It can either be an operator or an operand. */
@@ -19,11 +18,12 @@ struct Token
     Token(int opid) :
         is_operator(true),
         fid(0),
+        coeffs{},
         opid(opid)
     {}
 
     /* Construct operand. */
-    Token(int fid, const std::vector<double>& coeffs) :
+    Token(int fid, const coeffs_t& coeffs) :
         is_operator(false),
         fid(fid),
         coeffs(coeffs),
@@ -35,7 +35,7 @@ struct Token
     
     /* Operand. */
     int fid;
-    std::vector<double> coeffs;
+    coeffs_t coeffs;
 
     /* Operator. */
     int opid;
@@ -0,0 +1,567 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/*
+* GCC only vectorizes these loops at -O2 with the dynamic cost model, and the selects can only be vectorized if the comparisons
+* are allowed to ignore floating point exceptions. None of these options change the results of the functions.
+*/
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("tree-vectorize", "vect-cost-model=dynamic", "no-trapping-math")
+#endif
+
+#include "vector_math.h"
+
+#include <algorithm>
+#include <limits>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Compile the array functions for multiple instruction sets, and select the best one supported by the CPU at runtime.
+* The approximations are always inlined into the loops, the loops can't be vectorized otherwise.
+* There is no runtime selection with other compilers (eg. MSVC) or on Windows: the loops are only vectorized for the instruction set
+* targeted by the compiler options (SSE2 by default, /arch:AVX2 to use AVX2), and run on the CPUs supporting it.
+*/
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) && !defined(_WIN32)
+#define VECTOR_MATH_TARGETS __attribute__((flatten, target_clones("avx512f", "avx2", "default")))
+#elif defined(__GNUC__) || defined(__clang__)
+#define VECTOR_MATH_TARGETS __attribute__((flatten))
+#else
+#define VECTOR_MATH_TARGETS
+#endif
+
+
+/*
+* Scalar approximations used in the array functions.
+* They only use operations that can be vectorized: arithmetic, sqrt, selects, and 64 bit integer logical operations.
+* Every value is computed unconditionally and the results are selected afterwards, otherwise the loops can't be vectorized.
+* Conversions between integers and doubles are done by adding/subtracting large constants instead of casts.
+* The polynomial approximations of sin, cos, atan and asin are the ones used by fdlibm.
+*/
+
+namespace
+{
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    constexpr double quiet_nan = std::numeric_limits<double>::quiet_NaN();
+
+    /* pi/2 = pio2_hi + pio2_lo */
+    constexpr double pio2_hi = 1.57079632679489655800e+00;
+    constexpr double pio2_lo = 6.12323399573676603587e-17;
+
+    /* ln(2) split so that k*ln2_hi is exact for |k| < 2048. */
+    constexpr double ln2_hi = 6.93147180369123816490e-01;
+    constexpr double ln2_lo = 1.90821492927058770002e-10;
+    constexpr double log2e = 1.44269504088896338700e+00;
+
+    /* pi/2 split into 33 bit parts, so that k*pio2_i is exact for |k| < 2^20, and the tails of the parts. */
+    constexpr double pio2_1 = 1.57079632673412561417e+00;
+    constexpr double pio2_1t = 6.07710050650619224932e-11;
+    constexpr double pio2_2 = 6.07710050630396597660e-11;
+    constexpr double pio2_2t = 2.02226624879595063154e-21;
+    constexpr double pio2_3 = 2.02226624871116645580e-21;
+    constexpr double pio2_3t = 8.47842766036889956997e-32;
+    constexpr double twoopi = 6.36619772367581382433e-01;
+
+    /* Adding this constant to a double with |x| < 2^51 rounds it to an integer, which is then stored in the low bits of the result. */
+    constexpr double shifter = 0x1.8p52;
+
+    /* The number of values processed together by the functions that need square roots. */
+    constexpr size_t sqrt_chunk_size = 256;
+
+    inline uint64_t toBits(double x) noexcept
+    {
+        return std::bit_cast<uint64_t>(x);
+    }
+
+    inline double fromBits(uint64_t x) noexcept
+    {
+        return std::bit_cast<double>(x);
+    }
+
+    /* x with the low 32 bits of the mantissa cleared. */
+    inline double truncate32(double x) noexcept
+    {
+        return fromBits(toBits(x) & 0xffffffff00000000);
+    }
+
+    /* 2^k for an integer valued k in [-1022, 1023]. */
+    inline double exp2Int(double k) noexcept
+    {
+        return fromBits((toBits(k + shifter) << 52) + (uint64_t(1023) << 52));
+    }
+
+    /* Taylor polynomial of e^r - 1 on |r| <= ln(2)/2. */
+    inline double expm1Poly(double r) noexcept
+    {
+        double p = 1.0 / 6227020800.0;
+        p = p * r + 1.0 / 479001600.0;
+        p = p * r + 1.0 / 39916800.0;
+        p = p * r + 1.0 / 3628800.0;
+        p = p * r + 1.0 / 362880.0;
+        p = p * r + 1.0 / 40320.0;
+        p = p * r + 1.0 / 5040.0;
+        p = p * r + 1.0 / 720.0;
+        p = p * r + 1.0 / 120.0;
+        p = p * r + 1.0 / 24.0;
+        p = p * r + 1.0 / 6.0;
+        p = p * r + 1.0 / 2.0;
+
+        return r + r * r * p;
+    }
+
+    inline double expApprox(double x) noexcept
+    {
+        /* e^x = 2^k * e^r, where k = round(x/ln2), |r| <= ln(2)/2 */
+        double xc = (x < -746.0) ? -746.0 : x;
+        xc = (xc > 710.0) ? 710.0 : xc;
+
+        double k = (xc * log2e + shifter) - shifter;
+        double r = (xc - k * ln2_hi) - k * ln2_lo;
+        double er = 1.0 + expm1Poly(r);
+
+        /* The scaling is done in 2 steps so the results can overflow/underflow gradually. */
+        double k1 = (0.5 * k + shifter) - shifter;
+        double k2 = k - k1;
+        double result = er * exp2Int(k1) * exp2Int(k2);
+
+        return (x != x) ? x : result;
+    }
+
+    /* Series of ln(1+f) - f + f^2/2 - s*f^2/2, where s = f/(2+f), z = s^2 */
+    inline double logSeries(double z) noexcept
+    {
+        double p = 2.0 / 25.0;
+        p = p * z + 2.0 / 23.0;
+        p = p * z + 2.0 / 21.0;
+        p = p * z + 2.0 / 19.0;
+        p = p * z + 2.0 / 17.0;
+        p = p * z + 2.0 / 15.0;
+        p = p * z + 2.0 / 13.0;
+        p = p * z + 2.0 / 11.0;
+        p = p * z + 2.0 / 9.0;
+        p = p * z + 2.0 / 7.0;
+        p = p * z + 2.0 / 5.0;
+        p = p * z + 2.0 / 3.0;
+
+        return z * p;
+    }
+
+    inline double logApprox(double x) noexcept
+    {
+        /* Scale subnormals into the normal range. */
+        bool subnormal = x < std::numeric_limits<double>::min();
+        double x_scaled = x * 0x1p54;
+        double xs = subnormal ? x_scaled : x;
+        double k_adj = subnormal ? -54.0 : 0.0;
+
+        /* x = 2^k * m, where sqrt(2)/2 <= m < sqrt(2) */
+        uint64_t bits = toBits(xs);
+        uint64_t kb = (bits - toBits(0x1.6a09e667f3bcdp-1) + (uint64_t(0x400) << 52)) >> 52;
+        double m = fromBits(bits - (kb << 52) + (uint64_t(0x400) << 52));
+        double k = (fromBits(kb | toBits(0x1p52)) - 0x1p52) - 1024.0 + k_adj;
+
+        /* ln(m) = f - hfsq + s*(hfsq + R(s^2)) */
+        double f = m - 1.0;
+        double s = f / (2.0 + f);
+        double hfsq = 0.5 * f * f;
+        double log_m = f - (hfsq - s * (hfsq + logSeries(s * s)));
+
+        double result = k * ln2_hi + (log_m + k * ln2_lo);
+
+        result = (x == 0.0) ? -inf : result;
+        result = (x < 0.0) ? quiet_nan : result;
+        result = (x == inf) ? inf : result;
+
+        return (x != x) ? x : result;
+    }
+
+    inline double log1pApprox(double x, double lo = 0.0) noexcept
+    {
+        /* ln(1+x+lo) = ln(w) - ((w-1) - x - lo)/w, where w = 1+x, corrects the rounding error of w. lo is a small correction of x. */
+        double w = 1.0 + x;
+        double correction = (((w - 1.0) - x) - lo) / w;
+        correction = (w == 1.0 || w == inf) ? 0.0 : correction;
+        double result = logApprox(w) - correction;
+
+        return (w == 1.0) ? x + lo : result;
+    }
+
+    /* cos(x + y) and sin(x + y) on |x| <= pi/4, where y is the tail of x */
+    inline double cosKernel(double x, double y) noexcept
+    {
+        double z = x * x;
+        double w = z * z;
+        double r = z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * 2.48015872894767294178e-05)) +
+                   w * w * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11));
+        double hz = 0.5 * z;
+        w = 1.0 - hz;
+
+        return w + (((1.0 - w) - hz) + (z * r - x * y));
+    }
+
+    inline double sinKernel(double x, double y) noexcept
+    {
+        double z = x * x;
+        double w = z * z;
+        double r = 8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04 + z * 2.75573137070700676789e-06) +
+                   z * w * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10);
+        double v = z * x;
+
+        return x - ((z * (0.5 * y - v * r) - y) - v * -1.66666666666666324348e-01);
+    }
+
+    inline double cosApprox(double x) noexcept
+    {
+        /* x = k*pi/2 + (r + y), where |r| <= pi/4 and y is the tail of r */
+        double kd = x * twoopi + shifter;
+        uint64_t q = toBits(kd);
+        double k = kd - shifter;
+
+        double r = x - k * pio2_1;
+        double w = k * pio2_1t;
+        double t = r;
+        w = k * pio2_2;
+        r = t - w;
+        w = k * pio2_2t - ((t - r) - w);
+        t = r;
+        w = k * pio2_3;
+        r = t - w;
+        w = k * pio2_3t - ((t - r) - w);
+        double y0 = r - w;
+        double y1 = (r - y0) - w;
+
+        double c = cosKernel(y0, y1);
+        double s = sinKernel(y0, y1);
+
+        /* cos(x) = cos(r), -sin(r), -cos(r), sin(r) for k mod 4 = 0, 1, 2, 3 */
+        double result = (q & 1) ? s : c;
+        result = ((q + 1) & 2) ? -result : result;
+
+        return result;
+    }
+
+    inline double atanApprox(double x) noexcept
+    {
+        /* arctan(x) = arctan(c) + arctan((x - c)/(1 + c*x)) with c = 0, 0.5, 1, 1.5, inf depending on |x|. */
+        double a = std::abs(x);
+
+        bool r0 = a >= 0.4375;
+        bool r1 = a >= 0.6875;
+        bool r2 = a >= 1.1875;
+        bool r3 = a >= 2.4375;
+
+        double num = r0 ? 2.0 * a - 1.0 : a;
+        num = r1 ? a - 1.0 : num;
+        num = r2 ? a - 1.5 : num;
+        num = r3 ? -1.0 : num;
+
+        double den = r0 ? 2.0 + a : 1.0;
+        den = r1 ? a + 1.0 : den;
+        den = r2 ? 1.0 + 1.5 * a : den;
+        den = r3 ? a : den;
+
+        double hi = r0 ? 4.63647609000806093515e-01 : 0.0;
+        hi = r1 ? 7.85398163397448278999e-01 : hi;
+        hi = r2 ? 9.82793723247329054082e-01 : hi;
+        hi = r3 ? 1.57079632679489655800e+00 : hi;
+
+        double lo = r0 ? 2.26987774529616870924e-17 : 0.0;
+        lo = r1 ? 3.06161699786838301793e-17 : lo;
+        lo = r2 ? 1.39033110312309984516e-17 : lo;
+        lo = r3 ? 6.12323399573676603587e-17 : lo;
+
+        double t = num / den;
+        double z = t * t;
+        double w = z * z;
+        double s1 = z * (3.33333333333329318027e-01 + w * (1.42857142725034663711e-01 + w * (9.09088713343650656196e-02 +
+                    w * (6.66107313738753120669e-02 + w * (4.97687799461593236017e-02 + w * 1.62858201153657823623e-02)))));
+        double s2 = w * (-1.99999999998764832476e-01 + w * (-1.11111104054623557880e-01 + w * (-7.69187620504482999495e-02 +
+                    w * (-5.83357013379057348645e-02 + w * -3.65315727442169155270e-02))));
+
+        double result = hi - ((t * (s1 + s2) - lo) - t);
+
+        return std::copysign(result, x);
+    }
+
+    /* Rational approximation of (arcsin(sqrt(z)) - sqrt(z))/sqrt(z) on [0, 0.25]. */
+    inline double asinRatio(double z) noexcept
+    {
+        double p = z * (1.66666666666666657415e-01 + z * (-3.25565818622400915405e-01 + z * (2.01212532134862925881e-01 +
+                   z * (-4.00555345006794114027e-02 + z * (7.91534994289814532176e-04 + z * 3.47933107596021167570e-05)))));
+        double q = 1.0 + z * (-2.40339491173441421878e+00 + z * (2.02094576023350569471e+00 + z * (-6.88283971605453293030e-01 +
+                   z * 7.70381505559019352791e-02)));
+
+        return p / q;
+    }
+
+    /* The argument of asinRatio in asinApprox and acosApprox. */
+    inline double asinArg(double x) noexcept
+    {
+        double a = std::abs(x);
+
+        return (a < 0.5) ? x * x : (1.0 - a) * 0.5;
+    }
+
+    /* s = sqrt(asinArg(x)) */
+    inline double asinApprox(double x, double s) noexcept
+    {
+        /* arcsin(x) = x + x*R(x^2) for |x| < 0.5, and pi/2 - 2*arcsin(sqrt((1 - |x|)/2)) otherwise. */
+        double a = std::abs(x);
+        bool small = a < 0.5;
+
+        double z = asinArg(x);
+        double r = asinRatio(z);
+
+        double result_small = x + x * r;
+
+        /* Close to 1, the error of s doesn't matter. Otherwise s is split into 2 parts to compute the result more precisely. */
+        double result_near1 = pio2_hi - (2.0 * (s + s * r) - pio2_lo);
+        double f = truncate32(s);
+        double c = (z - f * f) / (s + f);
+        double result_mid = 0.5 * pio2_hi - (2.0 * s * r - (pio2_lo - 2.0 * c) - (0.5 * pio2_hi - 2.0 * f));
+
+        double result_large = (a >= 0.975) ? result_near1 : result_mid;
+
+        return small ? result_small : std::copysign(result_large, x);
+    }
+
+    /* s = sqrt(asinArg(x)) */
+    inline double acosApprox(double x, double s) noexcept
+    {
+        /* arccos(x) = pi/2 - arcsin(x) for |x| < 0.5, 2*arcsin(sqrt((1 - x)/2)) for x > 0.5, pi - 2*arcsin(sqrt((1 + x)/2)) for x < -0.5 */
+        double a = std::abs(x);
+        bool small = a < 0.5;
+
+        double z = asinArg(x);
+        double r = asinRatio(z);
+
+        double result_small = pio2_hi - (x - (pio2_lo - x * r));
+        double result_neg = 2.0 * (pio2_hi - (s + (r * s - pio2_lo)));
+        double df = truncate32(s);
+        double c = (z - df * df) / (s + df);
+        double result_pos = 2.0 * (df + (r * s + c));
+        result_pos = (x == 1.0) ? 0.0 : result_pos;
+
+        double result = (x < 0.0) ? result_neg : result_pos;
+
+        return small ? result_small : result;
+    }
+
+    /* s = sqrt(1 + x^2) */
+    inline double asinhApprox(double x, double s) noexcept
+    {
+        /* arsinh(x) = sgn(x)*ln(1 + |x| + x^2/(1 + sqrt(1 + x^2))), and sgn(x)*ln(2|x|) for large x */
+        double a = std::abs(x);
+        double result_small = log1pApprox(a + a * a / (1.0 + s));
+        double result_large = logApprox(a) + ln2_hi + ln2_lo;
+        double result = (a > 0x1p28) ? result_large : result_small;
+
+        return std::copysign(result, x);
+    }
+
+    /* s = sqrt(2t + t^2), where t = x - 1 */
+    inline double acoshApprox(double x, double s) noexcept
+    {
+        /* arcosh(x) = ln(1 + t + sqrt(2t + t^2)), and ln(2x) for large x */
+        double t = x - 1.0;
+        double u = t + s;
+
+        /*
+        * For t < 1, the rounding errors of t + s, of the square root and of its argument are not negligible compared to the result.
+        * They are corrected by splitting s and t into high and low parts like in asinApprox (s >= t, so the error of the sum is exact).
+        */
+        double f = truncate32(s);
+        double th = truncate32(t);
+        double tl = t - th;
+        double c = (((2.0 * t - f * f) + th * th) + (2.0 * th + tl) * tl) / (s + f);
+        double lo = (t - (u - s)) + (c - (s - f));
+        lo = (0.0 < t && t < 1.0) ? lo : 0.0;
+
+        double result_small = log1pApprox(u, lo);
+        double result_large = logApprox(x) + ln2_hi + ln2_lo;
+        double result = (x > 0x1p28) ? result_large : result_small;
+
+        return (x < 1.0) ? quiet_nan : result;
+    }
+
+    /*
+    * Evaluate an approximation that needs a square root for the n values starting at in, where sqrt_arg(x) is the argument
+    * of the square root and approx(x, sqrt(sqrt_arg(x))) is the result.
+    * The square roots are computed in a separate loop for each chunk of values, because std::sqrt may set errno, which
+    * prevents the vectorization of the loop it is in.
+    */
+    template<typename SqrtArg, typename Approx>
+    inline void evalWithSqrt(const double* in, double* out, size_t n, SqrtArg&& sqrt_arg, Approx&& approx)
+    {
+        double roots[sqrt_chunk_size];
+
+        for (size_t first = 0; first < n; first += sqrt_chunk_size)
+        {
+            size_t len = std::min(sqrt_chunk_size, n - first);
+
+            for (size_t i = 0; i < len; i++)
+            {
+                roots[i] = std::sqrt(sqrt_arg(in[first + i]));
+            }
+            for (size_t i = 0; i < len; i++)
+            {
+                out[first + i] = approx(in[first + i], roots[i]);
+            }
+        }
+    }
+
+    /* x^K by repeated squaring. */
+    template<int K>
+    inline double powInt(double x) noexcept
+    {
+        if constexpr (K == 0) return 1.0;
+        else if constexpr (K == 1) return x;
+        else
+        {
+            double half = powInt<K / 2>(x);
+            return (K % 2 == 0) ? half * half : half * half * x;
+        }
+    }
+
+    /*
+    * x^(+-K) or x^(+-(K + 1/2)) for the n values starting at in, depending on negative and half. The negative powers are computed as 1/x^K,
+    * or as (1/x)^K if x^K overflows. With the half integer exponents, -0 and -inf are replaced by +0 and +inf, so the results are the same
+    * as the ones of std::pow for them.
+    */
+    template<int K>
+    inline void powLoop(const double* in, double* out, size_t n, bool negative, bool half)
+    {
+        auto inverse = [](double x, double p, double root) { return std::isinf(p) ? powInt<K>(1.0 / x) / root : 1.0 / p; };
+
+        if (!half)
+        {
+            if (!negative) for (size_t i = 0; i < n; i++) out[i] = powInt<K>(in[i]);
+            else for (size_t i = 0; i < n; i++) out[i] = inverse(in[i], powInt<K>(in[i]), 1.0);
+        }
+        else
+        {
+            auto base = [](double x) { return (x == -inf) ? inf : x + 0.0; };
+
+            if (!negative) evalWithSqrt(in, out, n, base, [&](double x, double root) { return powInt<K>(base(x)) * root; });
+            else evalWithSqrt(in, out, n, base, [&](double x, double root) { return inverse(base(x), powInt<K>(base(x)) * root, root); });
+        }
+    }
+}
+
+
+VECTOR_MATH_TARGETS
+void fastExp(const double* in, double* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = expApprox(in[i]);
+    }
+}
+
+VECTOR_MATH_TARGETS
+void fastLog(const double* in, double* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = logApprox(in[i]);
+    }
+}
+
+VECTOR_MATH_TARGETS
+void fastCos(const double* in, double* out, size_t n)
+{
+    /* The range reduction is only accurate for |x| <= 2^20, other values are copied to out and computed separately. */
+    constexpr double limit = 0x1p20;
+
+    size_t num_large = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        double result = cosApprox(in[i]);
+        bool large = !(std::abs(in[i]) <= limit);
+        num_large += large;
+        out[i] = large ? in[i] : result;
+    }
+
+    if (num_large == 0) return;
+
+    /* The results of the approximation are in [-1, 1], so the large values are the ones left in out. */
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!(std::abs(out[i]) <= limit)) out[i] = std::cos(out[i]);
+    }
+}
+
+VECTOR_MATH_TARGETS
+void fastAsin(const double* in, double* out, size_t n)
+{
+    evalWithSqrt(in, out, n, asinArg, asinApprox);
+}
+
+VECTOR_MATH_TARGETS
+void fastAcos(const double* in, double* out, size_t n)
+{
+    evalWithSqrt(in, out, n, asinArg, acosApprox);
+}
+
+VECTOR_MATH_TARGETS
+void fastAtan(const double* in, double* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = atanApprox(in[i]);
+    }
+}
+
+VECTOR_MATH_TARGETS
+void fastAsinh(const double* in, double* out, size_t n)
+{
+    evalWithSqrt(in, out, n, [](double x) { return 1.0 + x * x; }, asinhApprox);
+}
+
+VECTOR_MATH_TARGETS
+void fastAcosh(const double* in, double* out, size_t n)
+{
+    evalWithSqrt(in, out, n, [](double x) { return 2.0 * (x - 1.0) + (x - 1.0) * (x - 1.0); }, acoshApprox);
+}
+
+VECTOR_MATH_TARGETS
+void fastAtanh(const double* in, double* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        /* artanh(x) = sgn(x)*ln(1 + 2|x|/(1 - |x|))/2 */
+        double x = in[i];
+        double a = std::abs(x);
+        double result = 0.5 * log1pApprox(2.0 * a / (1.0 - a));
+
+        out[i] = (a > 1.0) ? quiet_nan : std::copysign(result, x);
+    }
+}
+
+VECTOR_MATH_TARGETS
+void fastPow(const double* in, double* out, size_t n, double y)
+{
+    /* The exponents that are not multiples of 1/2, or are too large to be computed accurately by multiplications. */
+    double y2 = 2.0 * std::abs(y);
+    if (!(y2 <= 9.0) || y2 != std::round(y2))
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = std::pow(in[i], y);
+        }
+        return;
+    }
+
+    bool negative = (y < 0.0);
+    bool half = (int(y2) % 2 == 1);
+
+    switch (int(y2) / 2)
+    {
+        case 0: powLoop<0>(in, out, n, negative, half); break;
+        case 1: powLoop<1>(in, out, n, negative, half); break;
+        case 2: powLoop<2>(in, out, n, negative, half); break;
+        case 3: powLoop<3>(in, out, n, negative, half); break;
+        case 4: powLoop<4>(in, out, n, negative, half); break;
+    }
+}
\ No newline at end of file
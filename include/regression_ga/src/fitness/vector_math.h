@@ -0,0 +1,52 @@
+/* Copyright (c) 2021 Krisztin Rugsi. */
+
+/*
+* Vectorizable approximations of the transcendental functions used by the base functions.
+* Each function evaluates the approximation for n values starting at in, writing the results to out (in and out may be the same array).
+* The functions are written without branches so the compiler can vectorize them. With GCC/Clang on x86-64 they are also compiled for
+* AVX-512 and AVX2, and the best version supported by the CPU is selected at runtime (SSE2 is used otherwise).
+*
+* The errors given are the largest errors measured in ulps compared to a higher precision reference implementation.
+* Special values (NaN, infinities, values outside of the domain) give the same results as the standard library functions.
+*/
+
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+
+#include <cstddef>
+
+
+/* e^x, max error: 1 ulp. */
+void fastExp(const double* in, double* out, size_t n);
+
+/* ln(x), max error: 1.2 ulps. */
+void fastLog(const double* in, double* out, size_t n);
+
+/* cos(x), max error: 1.5 ulps. Values with |x| > 2^20 are computed using std::cos. */
+void fastCos(const double* in, double* out, size_t n);
+
+/* arcsin(x), max error: 1 ulp. */
+void fastAsin(const double* in, double* out, size_t n);
+
+/* arccos(x), max error: 1 ulp. */
+void fastAcos(const double* in, double* out, size_t n);
+
+/* arctan(x), max error: 1 ulp. */
+void fastAtan(const double* in, double* out, size_t n);
+
+/* arsinh(x), max error: 2.5 ulps. */
+void fastAsinh(const double* in, double* out, size_t n);
+
+/* arcosh(x), max error: 1.6 ulps. */
+void fastAcosh(const double* in, double* out, size_t n);
+
+/* artanh(x), max error: 2.5 ulps. */
+void fastAtanh(const double* in, double* out, size_t n);
+
+/*
+* x^y with the same exponent y for every value. Integer exponents with |y| <= 4 are computed by repeated squaring, and integer + 1/2 exponents
+* with |y| <= 4.5 with a square root and repeated squaring, max error: 5 ulps. Other exponents use std::pow.
+*/
+void fastPow(const double* in, double* out, size_t n, double y);
+
+#endif // !VECTOR_MATH_H
\ No newline at end of file
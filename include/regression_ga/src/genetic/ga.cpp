@@ -14,6 +14,7 @@
 #include <string>
 #include <utility>
 #include <limits>
+#include <cmath>
 #include <cstddef>
 #include <cstdlib>
 #include <cassert>
@@ -39,6 +40,12 @@ mGA::mGA(size_t chrom_len, fitnessFunction_t fitness_function, const std::string
     }
 }
 
+mGA::mGA(size_t chrom_len, const FitnessFunction& fitness_function, const std::string& fmask, const std::string& opmask, const limits_t& limits) :
+    mGA(chrom_len, fitnessFunction_t(fitness_function), fmask, opmask, limits)
+{
+    fitting_interval(fitness_function.x_min(), fitness_function.x_max());
+}
+
 /* Genetic operators. */
 
 mGA::Candidate mGA::generateCandidate() const
@@ -54,6 +61,13 @@ mGA::Candidate mGA::generateCandidate() const
         sol = generatePresetSol(chrom_len_, vars_per_func_, limits_, preset_form);
     }
 
+    if (use_domain_constraints)
+    {
+        if (std::isnan(x_min_)) throw std::logic_error("The fitting interval must be set to use the domain constraints.");
+
+        repairCoeffs(sol, limits_, x_min_, x_max_);
+    }
+
     return sol;
 }
 
@@ -95,6 +109,12 @@ void mGA::mutate(Candidate& child) const
     {
         mutateForm(child, mutation_rate_, fmask_, opmask_);
     }
+
+    /* The crossovers and mutations can both move the arguments of the base functions out of their domains. */
+    if (use_domain_constraints)
+    {
+        repairCoeffs(child, limits_, x_min_, x_max_);
+    }
 }
 
 
@@ -150,6 +170,17 @@ void mGA::limits(limits_t limits)
     limits_ = std::move(limits);
 }
 
+void mGA::fitting_interval(double x_min, double x_max)
+{
+    if (!(std::isfinite(x_min) && std::isfinite(x_max) && x_min <= x_max))
+    {
+        throw std::invalid_argument("The bounds of the fitting interval must be finite, and the lower bound must be less or equal to the upper bound.");
+    }
+
+    x_min_ = x_min;
+    x_max_ = x_max;
+}
+
 
 void mGA::crossover_method(CrossoverMethod method)
 {
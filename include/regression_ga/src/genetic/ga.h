@@ -8,9 +8,11 @@
 #include <vector>
 #include <utility>
 #include <string>
+#include <limits>
 #include <cstddef>
 
 #include "../../include/genetic_algorithm/base_ga.h"
+#include "../fitness/fitness_function.h"
 #include "gene.h"
 
 
@@ -43,14 +45,25 @@ public:
     /* Preset function form */
     std::vector<int> preset_form;
 
+    /*
+    * Keep the base functions of the genes defined on the fitting interval. (Affects initial Candidate generation and mutations.)
+    * The coefficients of the genes are chosen so their base functions are defined at every point of the interval where it is possible.
+    * The interval is the range of the data points if the GA was created with a FitnessFunction, otherwise it has to be set with fitting_interval.
+    */
+    bool use_domain_constraints = false;
+
     /* Contructors. */
     mGA() = delete;
     mGA(size_t chrom_len, fitnessFunction_t fitness_function, const std::string& fmask, const std::string& opmask, const limits_t& limits);
 
+    /* Use the range of the data points of fitness_function as the fitting interval. */
+    mGA(size_t chrom_len, const FitnessFunction& fitness_function, const std::string& fmask, const std::string& opmask, const limits_t& limits);
+
     /* Setters. */
     void fmask(std::string mask);
     void opmask(std::string mask);
     void limits(limits_t limits);
+    void fitting_interval(double x_min, double x_max);
 
     void crossover_method(CrossoverMethod method);
     void blx_crossover_param(double alpha);
@@ -64,7 +77,9 @@ private:
     std::string fmask_;                 /* Mask for the possible function indices to use. */
     std::string opmask_;                /* Mask for the possible operators to use. */
     limits_t limits_;                   /* The lower and upper bounds of each real-encoded coefficient of the genes. */
-    const size_t vars_per_func_ = 5;    /* The number of coefficients stores in a gene for a math function. */
+    static constexpr size_t vars_per_func_ = std::tuple_size_v<coeffs_t>;  /* The number of coefficients stores in a gene for a math function. */
+    double x_min_ = std::numeric_limits<double>::quiet_NaN();   /* The lower bound of the interval the function is fitted on (NaN if it isn't set). */
+    double x_max_ = std::numeric_limits<double>::quiet_NaN();   /* The upper bound of the interval the function is fitted on (NaN if it isn't set). */
 
     CrossoverMethod crossover_method_ = CrossoverMethod::simulated_binary;  /* The crossover method used in the GA. */
     double blx_crossover_param_ = 0.5;          /* The parameter of the BLX-alpha crossover. */
@@ -8,20 +8,23 @@
 #ifndef GENE_H
 #define GENE_H
 
-#include <vector>
+#include <array>
 #include <functional>
 #include <cstddef>
 
 
+/* The type of the coefficients of a base function. They are stored inline, so the genes can be copied without allocations. */
+using coeffs_t = std::array<double, 5>;
+
 /* The gene type used in the GA. */
 struct Gene
 {
     Gene() = delete;
-    Gene(int fid, const std::vector<double>& coeffs, int opid) : fid(fid), coeffs(coeffs), opid(opid) {}
+    Gene(int fid, const coeffs_t& coeffs, int opid) : fid(fid), coeffs(coeffs), opid(opid) {}
 
     /* Function. */
     int fid;
-    std::vector<double> coeffs;
+    coeffs_t coeffs;
 
     /* Operator. */
     int opid;
@@ -4,11 +4,13 @@
 #include "ga.h"
 #include "../fitness/math_ops.h"
 #include "../fitness/decoder.h"
+#include "../fitness/domain_analysis.h"
 #include "../../include/genetic_algorithm/rng.h"  /* Random number generation. */
 
 #include <algorithm>
 #include <vector>
 #include <string>
+#include <cmath>
 #include <cstddef>
 
 using namespace genetic_algorithm::rng;
@@ -48,21 +50,68 @@ int randomFunc(const std::string& fmask)
     return base_func_ids[randomIdx(base_func_ids.size())];
 }
 
-std::vector<double> generateCoeffs(size_t num_coeffs, const mGA::limits_t& bounds)
+coeffs_t generateCoeffs(size_t num_coeffs, const mGA::limits_t& bounds)
 {
     assert(num_coeffs == bounds.size());
+    assert(num_coeffs == coeffs_t().size());
 
-    std::vector<double> coeffs;
-    coeffs.reserve(num_coeffs);
-
+    coeffs_t coeffs;
     for (size_t i = 0; i < num_coeffs; i++)
     {
-        coeffs.push_back(randomReal(bounds[i].first, bounds[i].second));
+        coeffs[i] = randomReal(bounds[i].first, bounds[i].second);
     }
 
     return coeffs;
 }
 
+bool constrainCoeffs(int fid, coeffs_t& coeffs, const mGA::limits_t& bounds, double x_min, double x_max)
+{
+    assert(bounds.size() == coeffs.size());
+
+    if (DomainAnalysis::isDefined(fid, coeffs, x_min, x_max)) return false;
+
+    /*
+    * Move the argument of the function into its domain by drawing c from the values allowed with the current b, or with a few
+    * new values of b drawn from the values that allow the argument to stay in the domain over the whole interval.
+    */
+    auto [b_min, b_max] = DomainAnalysis::definedSlopes(fid, bounds[1], x_min, x_max);
+
+    constexpr size_t max_tries = 8;
+    for (size_t i = 0; i < max_tries && b_min <= b_max; i++)
+    {
+        double b = (i == 0) ? coeffs[1] : randomReal(b_min, b_max);
+
+        auto offsets = DomainAnalysis::definedOffsets(fid, b, bounds[2], x_min, x_max);
+        if (!offsets.empty())
+        {
+            auto [c_min, c_max] = offsets[randomIdx(offsets.size())];
+            coeffs[1] = b;
+            coeffs[2] = randomReal(c_min, c_max);
+
+            return true;
+        }
+    }
+
+    /*
+    * poly and rec are also defined everywhere with integer exponents.
+    * (root isn't changed, as the decoder uses 1/n as its exponent, which isn't exactly an integer for most n = 1/k.)
+    */
+    if (fid == 2 || fid == 3)
+    {
+        double n_min = std::ceil(bounds[4].first);
+        double n_max = std::floor(bounds[4].second);
+
+        if (n_min <= n_max)
+        {
+            coeffs[4] = std::clamp(std::round(coeffs[4]), n_min, n_max);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
 mGA::Candidate generateRandomSol(size_t chrom_len,
                                  size_t num_coeffs,
                                  const mGA::limits_t& bounds,
@@ -74,7 +123,7 @@ mGA::Candidate generateRandomSol(size_t chrom_len,
 
     for (size_t i = 0; i < chrom_len; i++)
     {
-        std::vector<double> coeffs = generateCoeffs(num_coeffs, bounds);
+        coeffs_t coeffs = generateCoeffs(num_coeffs, bounds);
         int fid = randomFunc(fmask);
         int opid = randomOperator(opmask);
 
@@ -96,7 +145,7 @@ mGA::Candidate generatePresetSol(size_t chrom_len,
 
     for (size_t i = 0; i < chrom_len; i++)
     {
-        std::vector<double> coeffs = generateCoeffs(num_coeffs, bounds);
+        coeffs_t coeffs = generateCoeffs(num_coeffs, bounds);
 
         int fid = presetf[2 * i];
 
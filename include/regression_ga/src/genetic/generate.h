@@ -18,8 +18,14 @@ int randomOperator(const std::string& opmask);
 /* Generate a random function index for which the value of the mask is 1. */
 int randomFunc(const std::string& fmask);
 
-/* Generate a random coefficient vector within the bounds. */
-std::vector<double> generateCoeffs(size_t num_coeffs, const mGA::limits_t& bounds);
+/* Generate random coefficients within the bounds. */
+coeffs_t generateCoeffs(size_t num_coeffs, const mGA::limits_t& bounds);
+
+/*
+* Change the coefficients b and c (or the exponent of poly and rec) within the bounds so that the base function fid is defined at every point in
+* [x_min, x_max], if it isn't already and it is possible. Returns true if the coefficients were changed.
+*/
+bool constrainCoeffs(int fid, coeffs_t& coeffs, const mGA::limits_t& bounds, double x_min, double x_max);
 
 /* Generate a completely random candidate. */
 mGA::Candidate generateRandomSol(size_t chrom_len,
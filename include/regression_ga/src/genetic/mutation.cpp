@@ -93,4 +93,17 @@ void mutateForm(mGA::Candidate& child, double pm, const std::string& fmask, cons
             child.is_evaluated = false;
         }
     }
+}
+
+void repairCoeffs(mGA::Candidate& child, const mGA::limits_t& bounds, double x_min, double x_max)
+{
+    assert(x_min <= x_max);
+
+    for (auto& gene : child.chromosome)
+    {
+        if (constrainCoeffs(gene.fid, gene.coeffs, bounds, x_min, x_max))
+        {
+            child.is_evaluated = false;
+        }
+    }
 }
\ No newline at end of file
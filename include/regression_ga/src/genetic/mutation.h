@@ -26,4 +26,7 @@ void gaussMutateCoeffs(mGA::Candidate& child, double pm, const mGA::limits_t& bo
 /* Performs mutation on the parts of the genes which encode the form of the function. */
 void mutateForm(mGA::Candidate& child, double pm, const std::string& fmask, const std::string& opmask);
 
+/* Changes the coefficients of the genes whose base functions are undefined somewhere in [x_min, x_max] so they are defined at every point where possible. */
+void repairCoeffs(mGA::Candidate& child, const mGA::limits_t& bounds, double x_min, double x_max);
+
 #endif // !MUTATION_H
\ No newline at end of file
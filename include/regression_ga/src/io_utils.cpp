@@ -1,23 +1,395 @@
 /* Copyright (c) 2021 Krisztin Rugsi. */
 
 #include "io_utils.h"
+#include "fitness/dataset.h"
 #include "fitness/decoder.h"
-#include "fitness/token.h"
+#include "fitness/program.h"
 #include "fitness/math_ops.h"
 
 #include <fstream>
 #include <algorithm>
+#include <execution>
 #include <vector>
 #include <string>
 #include <utility>
+#include <memory>
+#include <functional>
+#include <charconv>
+#include <system_error>
 #include <cwctype>
+#include <cstring>
+#include <cstdint>
 #include <cstddef>
 #include <cstdlib>
 #include <cassert>
 #include <stdexcept>
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
-std::vector<std::pair<double, double>> drawFunction(const std::vector<Token>& postfix_expr, double lbound, double ubound, size_t num_points)
+
+namespace
+{
+    /* The size of the chunks the data files are split into for parsing them in parallel, and the number of chunks parsed between the progress reports. */
+    constexpr size_t chunk_size = 1 << 20;
+    constexpr size_t chunks_per_batch = 16;
+
+    /* Return the extension of the file at path, including the dot. */
+    std::string fileType(const std::string& path)
+    {
+        size_t ext_pos = path.find_last_of(".");
+
+        return (ext_pos != std::string::npos) ? path.substr(ext_pos) : "";
+    }
+
+    /* A read-only view of the contents of a file mapped into memory. */
+    class MappedFile
+    {
+    public:
+
+        explicit MappedFile(const std::string& path)
+        {
+#ifdef _WIN32
+            HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                throw std::domain_error("Couldn't open the file.");
+            }
+
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file, &file_size))
+            {
+                CloseHandle(file);
+                throw std::domain_error("Couldn't open the file.");
+            }
+            size_ = size_t(file_size.QuadPart);
+
+            /* The view keeps the file mapped after the handles are closed. Empty files can't be mapped. */
+            if (size_ > 0)
+            {
+                HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                void* data = (mapping != nullptr) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+                if (mapping != nullptr) CloseHandle(mapping);
+                CloseHandle(file);
+
+                if (data == nullptr)
+                {
+                    throw std::domain_error("Couldn't map the file into memory.");
+                }
+                data_ = static_cast<const char*>(data);
+            }
+            else
+            {
+                CloseHandle(file);
+            }
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd == -1)
+            {
+                throw std::domain_error("Couldn't open the file.");
+            }
+
+            struct stat file_info;
+            if (::fstat(fd, &file_info) == -1)
+            {
+                ::close(fd);
+                throw std::domain_error("Couldn't open the file.");
+            }
+            size_ = size_t(file_info.st_size);
+
+            /* The mapping stays valid after the file is closed. Empty files can't be mapped. */
+            if (size_ > 0)
+            {
+                void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                ::close(fd);
+
+                if (data == MAP_FAILED)
+                {
+                    throw std::domain_error("Couldn't map the file into memory.");
+                }
+                ::madvise(data, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(data);
+            }
+            else
+            {
+                ::close(fd);
+            }
+#endif
+        }
+
+        ~MappedFile()
+        {
+            if (data_ == nullptr) return;
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            ::munmap(const_cast<char*>(data_), size_);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const noexcept { return data_; }
+        size_t size() const noexcept { return size_; }
+
+    private:
+
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    /* A part of a data file, consisting of whole lines. */
+    struct Chunk
+    {
+        const char* first;
+        const char* last;
+
+        size_t num_points = 0;          /* The number of points (non-blank lines) in the chunk. */
+        size_t offset = 0;              /* The index of the first point of the chunk in the file. */
+        const char* error = nullptr;    /* The reason the chunk couldn't be parsed, if it couldn't be. */
+    };
+
+    /* Call f(line_first, line_last) for each non-blank line in [first, last), without the line ending. */
+    template<typename F>
+    void forEachLine(const char* first, const char* last, F&& f)
+    {
+        while (first != last)
+        {
+            const char* eol = static_cast<const char*>(std::memchr(first, '\n', size_t(last - first)));
+            const char* line_last = (eol != nullptr) ? eol : last;
+
+            if (!std::all_of(first, line_last, [](char c) { return c == ' ' || c == '\t' || c == '\r'; }))
+            {
+                f(first, line_last);
+            }
+            first = (eol != nullptr) ? eol + 1 : last;
+        }
+    }
+
+    /* Parse the number at the start of [first, last) after any leading whitespace and + sign, ignoring the characters after it like atof. Returns false if there is no number there. */
+    bool parseNumber(const char* first, const char* last, double& value)
+    {
+        while (first != last && (*first == ' ' || *first == '\t')) first++;
+        if (first != last && *first == '+') first++;
+
+        return std::from_chars(first, last, value).ec == std::errc{};
+    }
+
+    /* Parse the points in the chunk into their place in the x and fx columns, or set the error of the chunk. */
+    void parseChunk(Chunk& chunk, char separator, double* x, double* fx)
+    {
+        size_t idx = chunk.offset;
+        forEachLine(chunk.first, chunk.last,
+        [&](const char* first, const char* last)
+        {
+            if (chunk.error != nullptr) return;
+
+            const char* sep = static_cast<const char*>(std::memchr(first, separator, size_t(last - first)));
+            if (sep == nullptr)
+            {
+                chunk.error = "Not every x value has a corresponding fx value in the file.";
+            }
+            else if (!parseNumber(first, sep, x[idx]) || !parseNumber(sep + 1, last, fx[idx]))
+            {
+                chunk.error = "The file contains values that are not numbers.";
+            }
+            idx++;
+        });
+    }
+
+    /* The header of the binary data files, see writeBinaryData. */
+    struct BinaryHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t type;
+        uint64_t num_points;
+        uint32_t flags;
+        uint32_t reserved;
+        double x_min, x_max;
+        double fx_min, fx_max;
+    };
+    static_assert(sizeof(BinaryHeader) == 64, "The header of the binary data files must be 64 bytes.");
+
+    constexpr char binary_magic[8] = { 'G', 'R', 'D', 'A', 'T', 'A', '\0', '\0' };
+    constexpr uint32_t binary_version = 1;
+    constexpr uint32_t flag_x_sorted = 1;
+    constexpr size_t column_alignment = 64;
+
+    /* Return the size of the values stored in a column of the given type. */
+    size_t valueSize(DataType type)
+    {
+        switch (type)
+        {
+            case DataType::float64:
+                return sizeof(double);
+            case DataType::float32:
+                return sizeof(float);
+            default:
+                assert(false);  /* Invalid data type. Shouldn't get here. */
+                std::abort();
+        }
+    }
+
+    /* Return value rounded to the precision of the values stored in a column of the given type. */
+    double storedValue(double value, DataType type)
+    {
+        switch (type)
+        {
+            case DataType::float64:
+                return value;
+            case DataType::float32:
+                return float(value);
+            default:
+                assert(false);  /* Invalid data type. Shouldn't get here. */
+                std::abort();
+        }
+    }
+
+    /* Return the size of a column of num_points values in a binary data file, including the padding after it. */
+    size_t columnSize(size_t num_points, DataType type)
+    {
+        return (num_points * valueSize(type) + column_alignment - 1) / column_alignment * column_alignment;
+    }
+
+    /* Write the values to the file as a column of the given type, followed by the padding. */
+    void writeColumn(std::ofstream& file, const std::vector<double>& values, DataType type)
+    {
+        switch (type)
+        {
+            case DataType::float64:
+                file.write(reinterpret_cast<const char*>(values.data()), std::streamsize(values.size() * sizeof(double)));
+                break;
+            case DataType::float32:
+            {
+                std::vector<float> floats(values.begin(), values.end());
+                file.write(reinterpret_cast<const char*>(floats.data()), std::streamsize(floats.size() * sizeof(float)));
+                break;
+            }
+            default:
+                assert(false);  /* Invalid data type. Shouldn't get here. */
+                std::abort();
+        }
+
+        const char padding[column_alignment] = {};
+        file.write(padding, std::streamsize(columnSize(values.size(), type) - values.size() * valueSize(type)));
+    }
+
+    /* Return the values of the column of num_points values of the given type starting at column. */
+    std::vector<double> readColumn(const char* column, size_t num_points, DataType type)
+    {
+        /* The columns are aligned, and the mapping starts at a page boundary, so the values can be read in place. */
+        switch (type)
+        {
+            case DataType::float64:
+            {
+                const double* values = reinterpret_cast<const double*>(column);
+                return std::vector<double>(values, values + num_points);
+            }
+            case DataType::float32:
+            {
+                const float* values = reinterpret_cast<const float*>(column);
+                return std::vector<double>(values, values + num_points);
+            }
+            default:
+                assert(false);  /* Invalid data type. Shouldn't get here. */
+                std::abort();
+        }
+    }
+
+    /* Return the header of a mapped binary data file, after checking that it is valid and the file contains every point. */
+    BinaryHeader readBinaryHeader(const MappedFile& file)
+    {
+        BinaryHeader header;
+        if (file.size() < sizeof(BinaryHeader))
+        {
+            throw std::domain_error("The file is not a binary data file.");
+        }
+        std::memcpy(&header, file.data(), sizeof(BinaryHeader));
+
+        if (std::memcmp(header.magic, binary_magic, sizeof(binary_magic)) != 0)
+        {
+            throw std::domain_error("The file is not a binary data file.");
+        }
+        if (header.version != binary_version)
+        {
+            throw std::domain_error("The version of the binary data file is not supported.");
+        }
+        if (header.type != uint32_t(DataType::float64) && header.type != uint32_t(DataType::float32))
+        {
+            throw std::domain_error("The type of the columns in the binary data file is not supported.");
+        }
+        if (header.num_points == 0)
+        {
+            throw std::domain_error("No data points were read from the file.");
+        }
+
+        const DataType type = DataType(header.type);
+
+        /* Check the size before computing the offsets, so they can't overflow. */
+        if (header.num_points > file.size() / valueSize(type) ||
+            sizeof(BinaryHeader) + columnSize(size_t(header.num_points), type) + size_t(header.num_points) * valueSize(type) > file.size())
+        {
+            throw std::domain_error("The binary data file is truncated.");
+        }
+
+        return header;
+    }
+
+    /*
+    * Return the summary of the num_points points starting at x stored in a binary data file from its header. The sorted flag is
+    * checked against the first and last x values, which are the min and max if the points are sorted.
+    */
+    Dataset::Summary readBinarySummary(const BinaryHeader& header, const double* x, size_t num_points)
+    {
+        assert(num_points > 0);
+
+        Dataset::Summary summary{ header.x_min, header.x_max, header.fx_min, header.fx_max, (header.flags & flag_x_sorted) != 0 };
+
+        if (!(summary.x_min <= summary.x_max) || !(summary.fx_min <= summary.fx_max) ||
+            (summary.x_sorted && (x[0] != summary.x_min || x[num_points - 1] != summary.x_max)))
+        {
+            throw std::domain_error("The header of the binary data file doesn't match its data points.");
+        }
+
+        return summary;
+    }
+
+    /* Read the data points from a mapped binary data file. */
+    std::pair<std::vector<double>, std::vector<double>> readBinaryData(const MappedFile& file, const std::function<void(double)>& progress)
+    {
+        const BinaryHeader header = readBinaryHeader(file);
+        const DataType type = DataType(header.type);
+
+        const size_t num_points = size_t(header.num_points);
+        const char* x_column = file.data() + sizeof(BinaryHeader);
+        const char* fx_column = x_column + columnSize(num_points, type);
+
+        std::vector<double> x = readColumn(x_column, num_points, type);
+        if (progress) progress(0.5);
+
+        std::vector<double> fx = readColumn(fx_column, num_points, type);
+        if (progress) progress(1.0);
+
+        /* Reject the files with a header that doesn't match their points. */
+        readBinarySummary(header, x.data(), num_points);
+
+        return { std::move(x), std::move(fx) };
+    }
+}
+
+std::vector<std::pair<double, double>> drawFunction(const Program& program, double lbound, double ubound, size_t num_points)
 {
     assert(lbound < ubound);
     assert(num_points > 0);
@@ -30,7 +402,7 @@ std::vector<std::pair<double, double>> drawFunction(const std::vector<Token>& po
         x[i] = lbound;
         lbound += increment;
     }
-    std::vector<double> fx = Decoder::evalPostfixExpr(postfix_expr, x);
+    std::vector<double> fx = Decoder::evalProgram(program, x);
 
     std::vector<std::pair<double, double>> points(num_points);
     for (size_t i = 0; i < points.size(); i++)
@@ -42,57 +414,192 @@ std::vector<std::pair<double, double>> drawFunction(const std::vector<Token>& po
     return points;
 }
 
-std::pair<std::vector<double>, std::vector<double>> readData(const std::string& path)
+std::pair<std::vector<double>, std::vector<double>> readData(const std::string& path, const std::function<void(double)>& progress)
 {
-    std::vector<double> x, fx;
-
-    std::string filetype = path.substr(path.find_last_of("."));
+    std::string filetype = fileType(path);
 
-    std::string separator;
-    if (filetype == ".txt")
+    char separator;
+    if (filetype == ".grd")
     {
-        separator = "\t";
+        return readBinaryData(MappedFile(path), progress);
+    }
+    else if (filetype == ".txt")
+    {
+        separator = '\t';
     }
     else if (filetype == ".csv")
     {
-        separator = ",";
+        separator = ',';
     }
     else
     {
-        throw std::domain_error("Only .txt and .csv files are supported.");
+        throw std::domain_error("Only .txt, .csv and .grd files are supported.");
     }
 
-    std::ifstream file(path, std::ios::in);
+    MappedFile file(path);
+    const char* const file_first = file.data();
+    const char* const file_last = file.data() + file.size();
 
-    std::string line;
-    while (std::getline(file, line))
+    /* Split the file into chunks of about chunk_size bytes, each of them ending at the end of a line. */
+    std::vector<Chunk> chunks;
+    for (const char* first = file_first; first != file_last; )
     {
-        std::string x_str, fx_str;
+        const char* last = first + std::min(chunk_size, size_t(file_last - first));
+        if (last != file_last)
+        {
+            const char* eol = static_cast<const char*>(std::memchr(last, '\n', size_t(file_last - last)));
+            last = (eol != nullptr) ? eol + 1 : file_last;
+        }
+        chunks.push_back({ first, last });
+        first = last;
+    }
 
-        x_str = line.substr(0, line.find(separator));
-        fx_str = line.substr(line.find(separator) + 1);
+    /* Count the points in each chunk first, so the points of every chunk can be parsed directly into their place in the columns. */
+    std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+    [](Chunk& chunk)
+    {
+        forEachLine(chunk.first, chunk.last, [&chunk](const char*, const char*) { chunk.num_points++; });
+    });
 
-        x.push_back(atof(x_str.c_str()));
-        fx.push_back(atof(fx_str.c_str()));
+    size_t num_points = 0;
+    for (auto& chunk : chunks)
+    {
+        chunk.offset = num_points;
+        num_points += chunk.num_points;
     }
 
-    if (x.size() == 0)
+    if (num_points == 0)
     {
         throw std::domain_error("No data points were read from the file.");
     }
+
+    std::vector<double> x(num_points), fx(num_points);
+
+    /* The chunks are parsed in batches, so the progress can be reported from the calling thread between them. */
+    for (size_t batch_first = 0; batch_first < chunks.size(); batch_first += chunks_per_batch)
+    {
+        size_t batch_last = std::min(batch_first + chunks_per_batch, chunks.size());
+
+        std::for_each(std::execution::par, chunks.begin() + batch_first, chunks.begin() + batch_last,
+        [&](Chunk& chunk)
+        {
+            parseChunk(chunk, separator, x.data(), fx.data());
+        });
+
+        /* The exceptions can't be thrown from the parallel algorithm, they are reported in the chunks instead. */
+        for (size_t i = batch_first; i < batch_last; i++)
+        {
+            if (chunks[i].error != nullptr) throw std::domain_error(chunks[i].error);
+        }
+
+        if (progress) progress(double(chunks[batch_last - 1].last - file_first) / double(file.size()));
+    }
+
+    return { std::move(x), std::move(fx) };
+}
+
+void writeBinaryData(const std::string& path, const std::vector<double>& x, const std::vector<double>& fx, DataType type)
+{
+    if (x.empty())
+    {
+        throw std::invalid_argument("There are no data points to write.");
+    }
     if (x.size() != fx.size())
     {
-        throw std::domain_error("Not every x value has a corresponding fx value in the file.");
+        throw std::invalid_argument("Not every x value has a corresponding fx value.");
+    }
+
+    BinaryHeader header = {};
+    std::memcpy(header.magic, binary_magic, sizeof(binary_magic));
+    header.version = binary_version;
+    header.type = uint32_t(type);
+    header.num_points = x.size();
+    header.flags = std::is_sorted(x.begin(), x.end()) ? flag_x_sorted : 0;
+
+    /* The range of the values as they are stored. Rounding the values to floats doesn't change their order, or whether they are sorted. */
+    auto [x_min, x_max] = std::minmax_element(x.begin(), x.end());
+    auto [fx_min, fx_max] = std::minmax_element(fx.begin(), fx.end());
+    header.x_min = storedValue(*x_min, type);
+    header.x_max = storedValue(*x_max, type);
+    header.fx_min = storedValue(*fx_min, type);
+    header.fx_max = storedValue(*fx_max, type);
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw std::domain_error("Couldn't open the file for writing.");
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(BinaryHeader));
+    writeColumn(file, x, type);
+    writeColumn(file, fx, type);
+
+    if (!file)
+    {
+        throw std::domain_error("Couldn't write the file.");
+    }
+}
+
+void convertData(const std::string& text_path, const std::string& binary_path, DataType type, const std::function<void(double)>& progress)
+{
+    auto [x, fx] = readData(text_path, progress);
+    writeBinaryData(binary_path, x, fx, type);
+}
+
+std::shared_ptr<const Dataset> mapData(const std::string& path, const std::function<void(double)>& progress)
+{
+    if (fileType(path) == ".grd")
+    {
+        auto file = std::make_shared<const MappedFile>(path);
+
+        const BinaryHeader header = readBinaryHeader(*file);
+        const DataType type = DataType(header.type);
+        const size_t num_points = size_t(header.num_points);
+
+        std::shared_ptr<Dataset> dataset;
+
+        /* The double columns are used in place, the dataset keeps the file mapped. */
+        if (type == DataType::float64)
+        {
+            const char* x_column = file->data() + sizeof(BinaryHeader);
+            const char* fx_column = x_column + columnSize(num_points, type);
+
+            dataset = std::make_shared<Dataset>(reinterpret_cast<const double*>(x_column), reinterpret_cast<const double*>(fx_column), num_points, file);
+            if (progress) progress(1.0);
+        }
+        else
+        {
+            auto [x, fx] = readBinaryData(*file, progress);
+            dataset = std::make_shared<Dataset>(std::move(x), std::move(fx));
+        }
+
+        /* The fitness function doesn't have to read every point to find the range of the x values. */
+        dataset->summary(readBinarySummary(header, dataset->x(), num_points));
+
+        return dataset;
     }
 
-    return { x, fx };
+    auto [x, fx] = readData(path, progress);
+
+    auto [x_min, x_max] = std::minmax_element(x.begin(), x.end());
+    auto [fx_min, fx_max] = std::minmax_element(fx.begin(), fx.end());
+    Dataset::Summary summary{ *x_min, *x_max, *fx_min, *fx_max, std::is_sorted(x.begin(), x.end()) };
+
+    auto dataset = std::make_shared<Dataset>(std::move(x), std::move(fx));
+    dataset->summary(summary);
+
+    return dataset;
 }
 
 std::pair<double, double> axisMinMax(const std::vector<double>& values, double pad)
 {
-    double min_val = *std::min_element(values.begin(), values.end());
-    double max_val = *std::max_element(values.begin(), values.end());
+    auto [min_val, max_val] = std::minmax_element(values.begin(), values.end());
 
+    return axisMinMax(*min_val, *max_val, pad);
+}
+
+std::pair<double, double> axisMinMax(double min_val, double max_val, double pad)
+{
     double interval_len = max_val - min_val;
 
     double int_min = min_val - pad*interval_len;
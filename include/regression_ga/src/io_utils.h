@@ -3,23 +3,59 @@
 #ifndef UTILS_H_
 #define UTILS_H_
 
-#include "fitness/token.h"
+#include "fitness/program.h"
+#include "fitness/dataset.h"
 
 #include <vector>
 #include <string>
 #include <utility>
+#include <memory>
+#include <functional>
 #include <cstddef>
 
 
-/* Return the points of the function represented by postfix_expr (x, fx values) for num_points number of equally spaced points between lbound and ubound. */
-std::vector<std::pair<double, double>> drawFunction(const std::vector<Token>& postfix_expr, double lbound, double ubound, size_t num_points);
-
-/* Read data points from a file, returning a vector of the x and the fx values of the points in the file. */
-std::pair<std::vector<double>, std::vector<double>> readData(const std::string& path);
+/* Return the points of the function represented by program (x, fx values) for num_points number of equally spaced points between lbound and ubound. */
+std::vector<std::pair<double, double>> drawFunction(const Program& program, double lbound, double ubound, size_t num_points);
+
+/*
+* Read data points from a file, returning a vector of the x and the fx values of the points in the file.
+* The .txt (tab separated) and .csv (comma separated) text files are memory mapped and parsed in parallel, in chunks split at line boundaries.
+* The blank lines are skipped. The .grd binary files are memory mapped, and their columns are copied without parsing.
+* If progress is set, it is called on the calling thread with the fraction of the file read so far.
+*/
+std::pair<std::vector<double>, std::vector<double>> readData(const std::string& path, const std::function<void(double)>& progress = nullptr);
+
+/* The types the columns of the binary data files can be stored as. */
+enum class DataType
+{
+    float64,    /* double */
+    float32     /* float, half the size, but only ~7 significant digits */
+};
+
+/*
+* Write the data points to a binary data file (.grd). The file consists of a 64 byte header, followed by the x and the fx columns.
+* The header contains the magic string "GRDATA" padded with zeros to 8 bytes, the format version (uint32), the type of the columns (uint32),
+* the number of points (uint64), the flags (uint32, bit 0 is set if the x values are in ascending order), 4 reserved bytes,
+* and the min and max of the values stored in the x and fx columns (4 doubles). Every column starts at a multiple of 64 bytes, and every value is in native byte order.
+*/
+void writeBinaryData(const std::string& path, const std::vector<double>& x, const std::vector<double>& fx, DataType type = DataType::float64);
+
+/* Convert a .txt or .csv data file to a binary data file, so it can be loaded without parsing it. */
+void convertData(const std::string& text_path, const std::string& binary_path, DataType type = DataType::float64, const std::function<void(double)>& progress = nullptr);
+
+/*
+* Open a data file as a dataset for the fitness function. The double columns of .grd files are used directly from the mapped file
+* without reading them into memory, so the file can be larger than the available memory. The other files are read using readData.
+* The datasets have a summary, which is read from the header of .grd files.
+*/
+std::shared_ptr<const Dataset> mapData(const std::string& path, const std::function<void(double)>& progress = nullptr);
 
 /* Calc the minimum and maximum values for a chart's axis values from the points displayed. */
 std::pair<double, double> axisMinMax(const std::vector<double>& values, double pad = 0.1);
 
+/* Calc the minimum and maximum values for a chart's axis values from the range of the points displayed. */
+std::pair<double, double> axisMinMax(double min_val, double max_val, double pad = 0.1);
+
 /* Convert the string from the preset field to a vector of operators and function indices. */
 std::vector<int> presetStringToFForm(std::string& preset);
 
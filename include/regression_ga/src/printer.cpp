@@ -61,7 +61,7 @@ std::string Printer::sign(double num)
 
 /* Simple functions. */
 
-std::string Printer::cPrint(const std::vector<double>& coeffs)
+std::string Printer::cPrint(const coeffs_t& coeffs)
 {
     /* f(x) = c */
     std::ostringstream sstream;
@@ -72,7 +72,7 @@ std::string Printer::cPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::linPrint(const std::vector<double>& coeffs)
+std::string Printer::linPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*x + d */
     std::ostringstream sstream;
@@ -83,7 +83,7 @@ std::string Printer::linPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::polyPrint(const std::vector<double>& coeffs)
+std::string Printer::polyPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*x^n + d */
     std::ostringstream sstream;
@@ -94,7 +94,7 @@ std::string Printer::polyPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::recPrint(const std::vector<double>& coeffs)
+std::string Printer::recPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a/(b*x + c)^n + d */
     std::ostringstream sstream;
@@ -105,7 +105,7 @@ std::string Printer::recPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::rootPrint(const std::vector<double>& coeffs)
+std::string Printer::rootPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*(b*x + c)^(1/n) + d */
     std::ostringstream sstream;
@@ -116,7 +116,7 @@ std::string Printer::rootPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::expPrint(const std::vector<double>& coeffs)
+std::string Printer::expPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*e^(b*x + c) + d */
     std::ostringstream sstream;
@@ -127,7 +127,7 @@ std::string Printer::expPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::logPrint(const std::vector<double>& coeffs)
+std::string Printer::logPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*ln(b*x + c) + d */
     std::ostringstream sstream;
@@ -140,7 +140,7 @@ std::string Printer::logPrint(const std::vector<double>& coeffs)
 
 /* Other functions. */
 
-std::string Printer::absPrint(const std::vector<double>& coeffs)
+std::string Printer::absPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*|x + c| + d */
     std::ostringstream sstream;
@@ -151,7 +151,7 @@ std::string Printer::absPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::sgnPrint(const std::vector<double>& coeffs)
+std::string Printer::sgnPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*sgn(x + c) + d */
     std::ostringstream sstream;
@@ -164,7 +164,7 @@ std::string Printer::sgnPrint(const std::vector<double>& coeffs)
 
 /* Trigonometric functions. */
 
-std::string Printer::cosPrint(const std::vector<double>& coeffs)
+std::string Printer::cosPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*cos(b*x + c) + d */
     std::ostringstream sstream;
@@ -177,7 +177,7 @@ std::string Printer::cosPrint(const std::vector<double>& coeffs)
 
 /* Inverse trigonometric functions. */
 
-std::string Printer::arcsinPrint(const std::vector<double>& coeffs)
+std::string Printer::arcsinPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*arcsin(bx + c) + d */
     std::ostringstream sstream;
@@ -188,7 +188,7 @@ std::string Printer::arcsinPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::arctanPrint(const std::vector<double>& coeffs)
+std::string Printer::arctanPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*arctan(bx + c) + d */
     std::ostringstream sstream;
@@ -199,7 +199,7 @@ std::string Printer::arctanPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::arcsecPrint(const std::vector<double>& coeffs)
+std::string Printer::arcsecPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*arcsec(b*x + c) + d */
     std::ostringstream sstream;
@@ -212,7 +212,7 @@ std::string Printer::arcsecPrint(const std::vector<double>& coeffs)
 
 /* Inverse hyperbolic functions. */
 
-std::string Printer::arsinhPrint(const std::vector<double>& coeffs)
+std::string Printer::arsinhPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*arsh(b*x + c) + d */
     std::ostringstream sstream;
@@ -223,7 +223,7 @@ std::string Printer::arsinhPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::arcoshPrint(const std::vector<double>& coeffs)
+std::string Printer::arcoshPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*arch(b*x + c) + d */
     std::ostringstream sstream;
@@ -234,7 +234,7 @@ std::string Printer::arcoshPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::artanhPrint(const std::vector<double>& coeffs)
+std::string Printer::artanhPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*arth(b*x + c) + d */
     std::ostringstream sstream;
@@ -245,7 +245,7 @@ std::string Printer::artanhPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::arctghPrint(const std::vector<double>& coeffs)
+std::string Printer::arctghPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*arctgh(b*x + c) + d */
     std::ostringstream sstream;
@@ -256,7 +256,7 @@ std::string Printer::arctghPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::arsechPrint(const std::vector<double>& coeffs)
+std::string Printer::arsechPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*arsech(b*x + c) + d */
     std::ostringstream sstream;
@@ -267,7 +267,7 @@ std::string Printer::arsechPrint(const std::vector<double>& coeffs)
     return sstream.str();
 }
 
-std::string Printer::arcschPrint(const std::vector<double>& coeffs)
+std::string Printer::arcschPrint(const coeffs_t& coeffs)
 {
     /* f(x) = a*arcsch(b*x + c) + d */
     std::ostringstream sstream;
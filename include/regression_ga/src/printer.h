@@ -19,7 +19,7 @@ public:
 
 private:
 
-    using mathFunctionPrinter_t = std::string(*)(const std::vector<double>& coeffs);
+    using mathFunctionPrinter_t = std::string(*)(const coeffs_t& coeffs);
 
     /* For displaying + signs (returns empty string on negative num). */
     static std::string sign(double num);
@@ -30,35 +30,35 @@ private:
     /* Printers for the base math functions used. */
 
     /* Simple functions. */
-    static std::string cPrint(const std::vector<double>& coeffs);
-    static std::string linPrint(const std::vector<double>& coeffs);
+    static std::string cPrint(const coeffs_t& coeffs);
+    static std::string linPrint(const coeffs_t& coeffs);
 
-    static std::string polyPrint(const std::vector<double>& coeffs);
-    static std::string recPrint(const std::vector<double>& coeffs);
-    static std::string rootPrint(const std::vector<double>& coeffs);
+    static std::string polyPrint(const coeffs_t& coeffs);
+    static std::string recPrint(const coeffs_t& coeffs);
+    static std::string rootPrint(const coeffs_t& coeffs);
 
-    static std::string expPrint(const std::vector<double>& coeffs);
-    static std::string logPrint(const std::vector<double>& coeffs);
+    static std::string expPrint(const coeffs_t& coeffs);
+    static std::string logPrint(const coeffs_t& coeffs);
 
     /* Other functions. */
-    static std::string absPrint(const std::vector<double>& coeffs);
-    static std::string sgnPrint(const std::vector<double>& coeffs);
+    static std::string absPrint(const coeffs_t& coeffs);
+    static std::string sgnPrint(const coeffs_t& coeffs);
 
     /* Trigonometric functions. */
-    static std::string cosPrint(const std::vector<double>& coeffs);
+    static std::string cosPrint(const coeffs_t& coeffs);
 
     /* Inverse trigonometric functions. */
-    static std::string arcsinPrint(const std::vector<double>& coeffs);
-    static std::string arctanPrint(const std::vector<double>& coeffs);
-    static std::string arcsecPrint(const std::vector<double>& coeffs);
+    static std::string arcsinPrint(const coeffs_t& coeffs);
+    static std::string arctanPrint(const coeffs_t& coeffs);
+    static std::string arcsecPrint(const coeffs_t& coeffs);
 
     /* Inverse hyperbolic functions. */
-    static std::string arsinhPrint(const std::vector<double>& coeffs);
-    static std::string arcoshPrint(const std::vector<double>& coeffs);
-    static std::string artanhPrint(const std::vector<double>& coeffs);
-    static std::string arctghPrint(const std::vector<double>& coeffs);
-    static std::string arsechPrint(const std::vector<double>& coeffs);
-    static std::string arcschPrint(const std::vector<double>& coeffs);
+    static std::string arsinhPrint(const coeffs_t& coeffs);
+    static std::string arcoshPrint(const coeffs_t& coeffs);
+    static std::string artanhPrint(const coeffs_t& coeffs);
+    static std::string arctghPrint(const coeffs_t& coeffs);
+    static std::string arsechPrint(const coeffs_t& coeffs);
+    static std::string arcschPrint(const coeffs_t& coeffs);
 
     /* Array of all the base math function printers. */
     static constexpr std::array<mathFunctionPrinter_t, 19> base_function_printers =